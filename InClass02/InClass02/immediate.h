@@ -0,0 +1,301 @@
+#pragma once
+
+// ImmediateMode
+//
+// glBegin/glVertex/glColor/glEnd style drawing on a core profile context.
+//
+//   - begin()/end() record vertices into a CPU-side list for the current frame
+//   - strips, fans, loops and quads are converted to GL_POINTS, GL_LINES or
+//     GL_TRIANGLES, so consecutive primitives of the same kind (and point size)
+//     are merged into one batch
+//   - flush() streams the whole frame into one (orphaned) vertex buffer and
+//     issues one glDrawArrays() per batch
+//
+// Vertex shader: the location (0: position attrib (vec3), 1: color (vec3))
+
+#ifndef IMMEDIATE_H
+#define IMMEDIATE_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <iostream>
+
+#ifndef GL_POLYGON
+#define GL_POLYGON 0x0009
+#endif
+
+using namespace std;
+
+class ImmediateMode {
+
+public:
+    ImmediateMode() {
+        curColor[0] = curColor[1] = curColor[2] = 1.0f;
+        curPointSize = 1.0f;
+        inPrimitive = false;
+        capacity = 0;
+        numDrawCalls = 0;
+        ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+        createProgram();
+        createBuffers();
+    }
+
+    ~ImmediateMode() {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteProgram(program);
+    }
+
+    // same as glOrtho() on an identity matrix
+    void ortho(float left, float right, float bottom, float top, float zNear, float zFar) {
+        for (int i = 0; i < 16; i++) projection[i] = 0.0f;
+        projection[0] = 2.0f / (right - left);
+        projection[5] = 2.0f / (top - bottom);
+        projection[10] = -2.0f / (zFar - zNear);
+        projection[12] = -(right + left) / (right - left);
+        projection[13] = -(top + bottom) / (top - bottom);
+        projection[14] = -(zFar + zNear) / (zFar - zNear);
+        projection[15] = 1.0f;
+    }
+
+    void pointSize(float size) {
+        curPointSize = size;
+    }
+
+    void color3f(float r, float g, float b) {
+        curColor[0] = r;
+        curColor[1] = g;
+        curColor[2] = b;
+    }
+
+    void begin(GLenum mode) {
+        if (inPrimitive) {
+            cout << "ImmediateMode::begin() called inside begin()/end()" << endl;
+            return;
+        }
+        curMode = mode;
+        inPrimitive = true;
+        primitive.clear();
+    }
+
+    void vertex3f(float x, float y, float z) {
+        Vertex v = { { x, y, z }, { curColor[0], curColor[1], curColor[2] } };
+        primitive.push_back(v);
+    }
+
+    void end() {
+        if (!inPrimitive) {
+            cout << "ImmediateMode::end() called without begin()" << endl;
+            return;
+        }
+        inPrimitive = false;
+
+        int n = (int)primitive.size();
+        int first = (int)vertices.size();
+        GLenum mode;
+
+        switch (curMode) {
+        case GL_POINTS:
+            mode = GL_POINTS;
+            for (int i = 0; i < n; i++) emit(i);
+            break;
+        case GL_LINES:
+            mode = GL_LINES;
+            for (int i = 0; i + 1 < n; i += 2) { emit(i); emit(i + 1); }
+            break;
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            mode = GL_LINES;
+            for (int i = 0; i + 1 < n; i++) { emit(i); emit(i + 1); }
+            if (curMode == GL_LINE_LOOP && n > 2) { emit(n - 1); emit(0); }
+            break;
+        case GL_TRIANGLES:
+            mode = GL_TRIANGLES;
+            for (int i = 0; i + 2 < n; i += 3) { emit(i); emit(i + 1); emit(i + 2); }
+            break;
+        case GL_TRIANGLE_STRIP:
+            mode = GL_TRIANGLES;
+            for (int i = 0; i + 2 < n; i++) {
+                // keep the winding of odd triangles consistent
+                if (i % 2 == 0) { emit(i); emit(i + 1); emit(i + 2); }
+                else { emit(i + 1); emit(i); emit(i + 2); }
+            }
+            break;
+        case GL_TRIANGLE_FAN:
+        case GL_POLYGON:
+            mode = GL_TRIANGLES;
+            for (int i = 1; i + 1 < n; i++) { emit(0); emit(i); emit(i + 1); }
+            break;
+        case GL_QUADS:
+            mode = GL_TRIANGLES;
+            for (int i = 0; i + 3 < n; i += 4) {
+                emit(i); emit(i + 1); emit(i + 2);
+                emit(i); emit(i + 2); emit(i + 3);
+            }
+            break;
+        default:
+            cout << "ImmediateMode::end() unsupported primitive mode: " << curMode << endl;
+            return;
+        }
+
+        int count = (int)vertices.size() - first;
+        if (count == 0) return;
+
+        // merge with the previous batch when the state is compatible
+        if (!batches.empty()) {
+            Batch &last = batches.back();
+            if (last.mode == mode && (mode != GL_POINTS || last.pointSize == curPointSize)) {
+                last.count += count;
+                return;
+            }
+        }
+        Batch b = { mode, first, count, curPointSize };
+        batches.push_back(b);
+    }
+
+    // upload the frame's vertices and draw all batches
+    void flush() {
+        numDrawCalls = 0;
+        if (vertices.empty()) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        size_t size = vertices.size() * sizeof(Vertex);
+        if (size > capacity) capacity = size * 2;
+        // orphan the previous frame's storage so the driver never waits on it
+        glBufferData(GL_ARRAY_BUFFER, capacity, 0, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glUseProgram(program);
+        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, projection);
+        glBindVertexArray(VAO);
+
+        float pointSize = -1.0f;
+        for (size_t i = 0; i < batches.size(); i++) {
+            if (batches[i].mode == GL_POINTS && batches[i].pointSize != pointSize) {
+                pointSize = batches[i].pointSize;
+                glUniform1f(pointSizeLoc, pointSize);
+            }
+            glDrawArrays(batches[i].mode, batches[i].first, batches[i].count);
+            numDrawCalls++;
+        }
+        glBindVertexArray(0);
+
+        vertices.clear();
+        batches.clear();
+    }
+
+    int numDrawCalls;    // # of draw calls issued by the last flush()
+
+private:
+    struct Vertex {
+        float pos[3];
+        float color[3];
+    };
+
+    struct Batch {
+        GLenum mode;     // GL_POINTS, GL_LINES or GL_TRIANGLES
+        int first;
+        int count;
+        float pointSize;
+    };
+
+    vector<Vertex> primitive;   // vertices of the current begin()/end() pair
+    vector<Vertex> vertices;    // converted vertices of the whole frame
+    vector<Batch> batches;
+
+    GLenum curMode;
+    bool inPrimitive;
+    float curColor[3];
+    float curPointSize;
+    float projection[16];
+
+    unsigned int program;
+    int projectionLoc;
+    int pointSizeLoc;
+    unsigned int VAO;
+    unsigned int VBO;
+    size_t capacity;            // current size of the streaming buffer in bytes
+
+    void emit(int i) {
+        vertices.push_back(primitive[i]);
+    }
+
+    void createProgram() {
+        const char* vertexShaderSource = "#version 330 core\n"
+            "layout (location = 0) in vec3 aPos;\n"
+            "layout (location = 1) in vec3 aColor;\n"
+            "uniform mat4 projection;\n"
+            "uniform float pointSize;\n"
+            "out vec3 toColor;\n"
+            "void main()\n"
+            "{\n"
+            "   gl_Position = projection * vec4(aPos, 1.0);\n"
+            "   gl_PointSize = pointSize;\n"
+            "   toColor = aColor;\n"
+            "}\0";
+        const char* fragmentShaderSource = "#version 330 core\n"
+            "in vec3 toColor;\n"
+            "out vec4 FragColor;\n"
+            "void main()\n"
+            "{\n"
+            "   FragColor = vec4(toColor, 1.0);\n"
+            "}\n\0";
+
+        int success;
+        char infoLog[512];
+
+        int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+        glCompileShader(vertexShader);
+        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+            cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << endl;
+        }
+
+        int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+        glCompileShader(fragmentShader);
+        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+            cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << endl;
+        }
+
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+        }
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        projectionLoc = glGetUniformLocation(program, "projection");
+        pointSizeLoc = glGetUniformLocation(program, "pointSize");
+
+        // gl_PointSize is ignored unless this is enabled
+        glEnable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    void createBuffers() {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+};
+
+
+#endif
@@ -1,10 +1,14 @@
 // Immediate Mode Example using glfw
+// - glBegin/glEnd style drawing emulated on a core profile context (immediate.h)
 
+#include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "immediate.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void setProjection();
 
 // window size
 unsigned int SCR_WIDTH = 800;
@@ -12,6 +16,7 @@ unsigned int SCR_HEIGHT = 800;
 
 //globals
 bool fillTriangle = true;
+ImmediateMode* im = NULL;
 
 int main()
 {
@@ -21,6 +26,10 @@ int main()
         std::cout << "Failed to initiallize GLFW" << std::endl;
         return -1;
     }; 
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
     // glfw window creation
     // --------------------
@@ -34,8 +43,20 @@ int main()
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetKeyCallback(window, key_callback);
-    
 
+    // Allow modern extension features
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK)
+    {
+        std::cout << "GLEW initialisation failed!" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+
+    // immediate mode emulation (streaming vertex buffer + batching)
+    im = new ImmediateMode();
+    setProjection();
     
     // render loop
     // -----------
@@ -43,61 +64,61 @@ int main()
     {
         glClear(GL_COLOR_BUFFER_BIT);
         
-        // setting the camera
+        // setting the camera (projection is only rebuilt on resize)
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClearColor(0.2f, 0.3f, 0.4f, 1.0f);
-        float ratio = SCR_WIDTH / (float)SCR_HEIGHT;
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
         
         // triangle (red)
-        glColor3f(1.f, 0.f, 0.f);
-        glBegin(GL_TRIANGLES);
-            glVertex3f(-0.8f, -0.8f, 0.f);
-            glVertex3f(-0.2f, -0.8f, 0.f);
-            glVertex3f(-0.5f, -0.2f, 0.f);
-        glEnd();
+        im->color3f(1.f, 0.f, 0.f);
+        im->begin(GL_TRIANGLES);
+            im->vertex3f(-0.8f, -0.8f, 0.f);
+            im->vertex3f(-0.2f, -0.8f, 0.f);
+            im->vertex3f(-0.5f, -0.2f, 0.f);
+        im->end();
         
         // point on the left top (point)
-        glPointSize(3.0);
-        glColor3f(1.f, 1.f, 0.f);
-        glBegin(GL_POINTS);
-            glVertex3f(-0.8f, 0.2f, 0.f);
-            glVertex3f(-0.2f, 0.2f, 0.f);
-            glVertex3f(-0.5f, 0.8f, 0.f);
-        glEnd();
+        im->pointSize(3.0);
+        im->color3f(1.f, 1.f, 0.f);
+        im->begin(GL_POINTS);
+            im->vertex3f(-0.8f, 0.2f, 0.f);
+            im->vertex3f(-0.2f, 0.2f, 0.f);
+            im->vertex3f(-0.5f, 0.8f, 0.f);
+        im->end();
 
         // triangle on the right top (mixed color)
-        glColor3f(1.f, 0.f, 0.f);
-        glBegin(GL_TRIANGLES);
-            glVertex3f(0.8f, 0.2f, 0.f);
-            glColor3f(0.f, 0.f, 1.f);
-            glVertex3f(0.2f, 0.2f, 0.f);
-            glColor3f(0.f, 1.f, 0.f);
-            glVertex3f(0.5f, 0.8f, 0.f);
-        glEnd();
+        im->color3f(1.f, 0.f, 0.f);
+        im->begin(GL_TRIANGLES);
+            im->vertex3f(0.8f, 0.2f, 0.f);
+            im->color3f(0.f, 0.f, 1.f);
+            im->vertex3f(0.2f, 0.2f, 0.f);
+            im->color3f(0.f, 1.f, 0.f);
+            im->vertex3f(0.5f, 0.8f, 0.f);
+        im->end();
 
         // Triangle on the right bottom (border)
-        glColor3f(0.f, 1.f, 0.f);
-        glBegin(GL_TRIANGLES);
-             glVertex3f(0.8f, -0.8f, 0.f);
-             glVertex3f(0.2f, -0.8f, 0.f);
-             glVertex3f(0.5f, -0.2f, 0.f);
-        glEnd();
-        glColor3f(1.f, 1.f, 1.f);
-        glBegin(GL_LINE_LOOP);
-            glVertex3f(0.8f, -0.8f, 0.f);
-            glVertex3f(0.2f, -0.8f, 0.f);
-            glVertex3f(0.5f, -0.2f, 0.f);
-        glEnd();
+        im->color3f(0.f, 1.f, 0.f);
+        im->begin(GL_TRIANGLES);
+             im->vertex3f(0.8f, -0.8f, 0.f);
+             im->vertex3f(0.2f, -0.8f, 0.f);
+             im->vertex3f(0.5f, -0.2f, 0.f);
+        im->end();
+        im->color3f(1.f, 1.f, 1.f);
+        im->begin(GL_LINE_LOOP);
+            im->vertex3f(0.8f, -0.8f, 0.f);
+            im->vertex3f(0.2f, -0.8f, 0.f);
+            im->vertex3f(0.5f, -0.2f, 0.f);
+        im->end();
+
+        // draw everything recorded this frame
+        im->flush();
+
         // Swap buffers
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    delete im;
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -124,4 +145,14 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(width/2, 0, width/2, height/2);
     SCR_WIDTH = width;
     SCR_HEIGHT = height;
+    setProjection();
+}
+
+// orthographic projection keeping the aspect ratio of the window
+// ---------------------------------------------------------------------------------------------
+void setProjection()
+{
+    if (im == NULL || SCR_HEIGHT == 0) return;
+    float ratio = SCR_WIDTH / (float)SCR_HEIGHT;
+    im->ortho(-ratio, ratio, -1.f, 1.f, 1.f, -1.f);
 }
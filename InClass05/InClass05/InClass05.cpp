@@ -1,69 +1,47 @@
-#define _USE_MATH_DEFINES
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
 #include <shader.h>
+#include "primitive_renderer.h"
 
 using namespace std;
 
 // types
 class CircleObject {
 public:
-    CircleObject() { };
-    CircleObject(Shader *shader) {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        this->shader = shader;
-        double pi = M_PI;
-        double radius = 0.5f;
-        for (int i = 0; i < 360; ++i) {
-            double angle = i * pi / 180;
-            this->v[2 * i] = radius * cos(angle);
-            this->v[(2 * i) + 1] = 0.25f + radius * sin(angle);
-        }
+    CircleObject() {
+        this->cx = 0.0f;
+        this->cy = 0.25f;
+        this->radius = 0.5f;
     };
-    float v[720]; // vertex data
-    unsigned int VAO;  // vertex array object
-    unsigned int VBO;  // vertex buffer object
-    Shader *shader;          // shader to be used
+    float cx, cy;      // center
+    float radius;
 };
 
 class LineObject {
 public:
-    LineObject() { };
-    LineObject(Shader* shader) {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        this->shader = shader;
+    LineObject() {
         this->v[0] = 0.0f;
         this->v[1] = 0.0f;
         this->v[2] = 0.85f;
         this->v[3] = 0.5f;
     };
-    float v[4]; // vertex data
-    unsigned int VAO;  // vertex array object
-    unsigned int VBO;  // vertex buffer object
-    Shader* shader;          // shader to be used
+    float v[4]; // end points (x0, y0, x1, y1)
 };
 
 class InterObject {
 public:
-    InterObject() { };
-    InterObject(Shader* shader) {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        this->shader = shader;
+    InterObject() {
+        nInter = 0;
     };
-    void setV(float x, float y) {
-        v[0] = x;
-        v[1] = y;
+    void addV(float x, float y) {
+        v[2 * nInter] = x;
+        v[2 * nInter + 1] = y;
+        nInter += 1;
     }
-    float v[2]; // vertex data
+    float v[4]; // at most two intersection points
     int nInter;
-    unsigned int VAO;  // vertex array object
-    unsigned int VBO;  // vertex buffer object
-    Shader* shader;          // shader to be used
 };
 
 // function prototypes
@@ -75,53 +53,34 @@ void render();
 
 // global variables
 GLFWwindow *window = NULL;
-Shader *globalShader = NULL;
+Shader *primitiveShader = NULL;
+PrimitiveRenderer *primitives = NULL;
 CircleObject *circle = NULL;
 LineObject *line = NULL;
 InterObject* interSection = NULL;
 unsigned int SCR_WIDTH = 800;
 unsigned int SCR_HEIGHT = 800;
-unsigned int interVAO;
-unsigned int interVBO;
-int nInter = 0;
-float interV[2] = { 0.0f, };
 
 int main()
 {
     window = glAllInit();
 
-    
-    globalShader = new Shader("vertex_shader.vs", "fragment_shader.fs");
-    
-    circle = new CircleObject(globalShader);
-    line = new LineObject(globalShader);
-    interSection = new InterObject(globalShader);
-
-    glBindVertexArray(circle->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, circle->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(circle->v), circle->v, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glBindVertexArray(line->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, line->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(line->v), line->v, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+
+    primitiveShader = new Shader("primitive.vs", "primitive.fs");
+    primitives = new PrimitiveRenderer(primitiveShader);
+
+    circle = new CircleObject();
+    line = new LineObject();
+    interSection = new InterObject();
 
     compute_intersection();
 
-    glBindVertexArray(interSection->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, interSection->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(interSection->v), interSection->v, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // the scene is static: record every primitive once, all of them are drawn with a single call
+    primitives->addCircle(circle->cx, circle->cy, circle->radius, 1.0f, 0.0f, 0.0f, 1.0f, 1.5f);
+    primitives->addSegment(line->v[0], line->v[1], line->v[2], line->v[3], 0.0f, 1.0f, 0.0f, 1.0f, 1.5f);
+    for (int i = 0; i < interSection->nInter; i++) {
+        primitives->addPoint(interSection->v[2 * i], interSection->v[2 * i + 1], 1.0f, 1.0f, 0.0f, 1.0f, 15.0f);
+    }
 
     // render loop
     while (!glfwWindowShouldClose(window)) {
@@ -180,54 +139,33 @@ GLFWwindow *glAllInit()
 void render() {
     
     glClear(GL_COLOR_BUFFER_BIT);
-    circle->shader->use();
-    glBindVertexArray(circle->VAO);
-    circle->shader->setVec4("inColor", 1.0f, 0.0f, 0.0f, 1.0f);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glDrawArrays(GL_LINE_LOOP, 0, 360);
-    glBindVertexArray(0);
-
-    line->shader->use();
-    glBindVertexArray(line->VAO);
-    line->shader->setVec4("inColor", 0.0f, 1.0f, 0.0f, 1.0f);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glDrawArrays(GL_LINE_LOOP, 0, 2);
-    glBindVertexArray(0);
-
-    if (interSection->nInter > 0) {
-        glPointSize(15.0f);
-        globalShader->use();
-        glBindVertexArray(interSection->VAO);
-        globalShader->setVec4("inColor", 1.0f, 1.0f, 0.0f, 1.0f);
-        glDrawArrays(GL_POINTS, 0, interSection->nInter);
-        glBindVertexArray(0);
-    }
+    primitives->draw(SCR_WIDTH, SCR_HEIGHT);
     
     glfwSwapBuffers(window);
 }
 
 void compute_intersection() {
-    //(0, 0)~(0.85, 0.5) -> y = (0.5/0.85) * x -> (0.5/0.85) * x - y = 0
-    float a = (line->v[3] - line->v[1]) / (line->v[2] - line->v[0]),
-          b = -1,
-          c = b * line->v[1] - a * line->v[0];
-    
-    float t;
-    for (int i = 0; i < 359; i++) {
-        float x1 = circle->v[2 * i],
-              y1 = circle->v[2 * i + 1],
-              x2 = circle->v[2 * i + 2],
-              y2 = circle->v[2 * i + 3];
-
-        t = -1 * (a * x1 + b * y1 + c) / (a * (x2 - x1) + b * (y2 - y1));
-
-        if (0.0f <= t && t <= 1.0f) {
-            float temp_x = (1 - t) * x1 + t * x2,
-                  temp_y = (1 - t) * y1 + t * y2;
-            if (line->v[0] <= temp_x && temp_x <= line->v[2] && line->v[1] <= temp_y && temp_y <= line->v[3]) {
-                interSection->setV(temp_x, temp_y);
-                interSection->nInter += 1;
-            }
+    // segment p(t) = p0 + t * d (0 <= t <= 1) against the circle |p - c| = r
+    //   -> (d.d) t^2 + 2 (d.f) t + (f.f - r^2) = 0, where f = p0 - c
+    float dx = line->v[2] - line->v[0],
+          dy = line->v[3] - line->v[1],
+          fx = line->v[0] - circle->cx,
+          fy = line->v[1] - circle->cy;
+
+    float a = dx * dx + dy * dy,
+          b = 2.0f * (dx * fx + dy * fy),
+          c = fx * fx + fy * fy - circle->radius * circle->radius;
+
+    float disc = b * b - 4.0f * a * c;
+    if (a == 0.0f || disc < 0.0f) return;
+
+    float sq = sqrt(disc);
+    float t[2] = { (-b - sq) / (2.0f * a), (-b + sq) / (2.0f * a) };
+    int nRoot = (disc == 0.0f) ? 1 : 2;
+
+    for (int i = 0; i < nRoot; i++) {
+        if (0.0f <= t[i] && t[i] <= 1.0f) {
+            interSection->addV(line->v[0] + t[i] * dx, line->v[1] + t[i] * dy);
         }
     }
 }
@@ -0,0 +1,39 @@
+#version 330 core
+flat in vec4 shape;
+flat in vec4 color;
+flat in vec2 style;
+in vec2 fragPos;
+
+out vec4 FragColor;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    float halfWidth = style.x / viewportSize.y;   // pixels -> NDC
+    int type = int(style.y + 0.5);
+    float d;
+
+    if (type == 0) {
+        // circle outline
+        d = abs(length(fragPos - shape.xy) - shape.z) - halfWidth;
+    }
+    else if (type == 1) {
+        // segment: distance to the closest point on [p0, p1]
+        vec2 pa = fragPos - shape.xy;
+        vec2 ba = shape.zw - shape.xy;
+        float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-12), 0.0, 1.0);
+        d = length(pa - ba * h) - halfWidth;
+    }
+    else {
+        // filled point
+        d = length(fragPos - shape.xy) - halfWidth;
+    }
+
+    // analytic antialiasing over one pixel footprint of the distance field
+    float aa = fwidth(d);
+    float alpha = 1.0 - smoothstep(-aa, aa, d);
+    if (alpha <= 0.0) discard;
+
+    FragColor = vec4(color.rgb, color.a * alpha);
+}
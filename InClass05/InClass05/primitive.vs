@@ -0,0 +1,39 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;   // unit quad corner in [-1, 1]
+layout (location = 1) in vec4 aShape;    // circle/point: (cx, cy, radius, -), segment: (x0, y0, x1, y1)
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in vec2 aStyle;    // x: width in pixels, y: primitive type
+
+flat out vec4 shape;
+flat out vec4 color;
+flat out vec2 style;
+out vec2 fragPos;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    // half width plus one pixel of room for the antialiasing ramp (in NDC)
+    vec2 pad = (0.5 * aStyle.x + 1.0) * 2.0 / viewportSize;
+    int type = int(aStyle.y + 0.5);
+
+    if (type == 1) {
+        // segment: quad oriented along the segment
+        vec2 dir = aShape.zw - aShape.xy;
+        float len = length(dir);
+        dir = (len > 0.0) ? dir / len : vec2(1.0, 0.0);
+        vec2 perp = vec2(-dir.y, dir.x);
+        float extent = max(pad.x, pad.y);
+        vec2 center = 0.5 * (aShape.xy + aShape.zw);
+        fragPos = center + dir * aCorner.x * (0.5 * len + extent) + perp * aCorner.y * extent;
+    }
+    else {
+        // circle and point: bounding square around the disc
+        fragPos = aShape.xy + aCorner * (vec2(aShape.z) + pad);
+    }
+
+    shape = aShape;
+    color = aColor;
+    style = aStyle;
+    gl_Position = vec4(fragPos, 0.0, 1.0);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// PrimitiveRenderer
+//
+// Draws circles, line segments and points as screen-aligned quads whose
+// coverage is evaluated with a signed distance function in the fragment shader.
+//
+//   - every primitive costs 4 vertices (one instance of a unit quad)
+//   - all primitives are drawn with a single glDrawArraysInstanced() call
+//   - edges are antialiased analytically (fwidth of the distance)
+//
+// Positions and radii are in NDC, widths are in pixels.
+//
+// Vertex shader: location 0: quad corner (vec2), 1: shape (vec4),
+//                location 2: color (vec4), 3: style (vec2: width, type)
+
+#ifndef PRIMITIVE_RENDERER_H
+#define PRIMITIVE_RENDERER_H
+
+#include <vector>
+#include <cstddef>
+#include "shader.h"
+
+using namespace std;
+
+enum PrimitiveType {
+    PRIM_CIRCLE = 0,     // ring: shape = (cx, cy, radius, -)
+    PRIM_SEGMENT = 1,    // line segment: shape = (x0, y0, x1, y1)
+    PRIM_POINT = 2       // filled disc: shape = (cx, cy, -, -), diameter = width
+};
+
+// per-instance data (10 floats)
+struct Primitive {
+    float shape[4];
+    float color[4];
+    float width;
+    float type;
+};
+
+class PrimitiveRenderer {
+
+public:
+    Shader *shader;
+
+    PrimitiveRenderer(Shader *shader) {
+        this->shader = shader;
+        capacity = 0;
+        dirty = true;
+        createBuffers();
+    }
+
+    void clear() {
+        primitives.clear();
+        dirty = true;
+    }
+
+    void addCircle(float cx, float cy, float radius, float r, float g, float b, float a, float width) {
+        add(PRIM_CIRCLE, cx, cy, radius, 0.0f, r, g, b, a, width);
+    }
+
+    void addSegment(float x0, float y0, float x1, float y1, float r, float g, float b, float a, float width) {
+        add(PRIM_SEGMENT, x0, y0, x1, y1, r, g, b, a, width);
+    }
+
+    void addPoint(float x, float y, float r, float g, float b, float a, float size) {
+        add(PRIM_POINT, x, y, 0.0f, 0.0f, r, g, b, a, size);
+    }
+
+    int size() { return (int)primitives.size(); }
+
+    void draw(unsigned int viewportWidth, unsigned int viewportHeight) {
+        if (primitives.empty()) return;
+        if (dirty) updateBuffers();
+
+        shader->use();
+        shader->setVec2("viewportSize", (float)viewportWidth, (float)viewportHeight);
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)primitives.size());
+        glBindVertexArray(0);
+    }
+
+private:
+    vector<Primitive> primitives;
+    size_t capacity;    // # of primitives the instance buffer can hold
+    bool dirty;         // primitives changed since the last upload
+
+    unsigned int VAO;
+    // VBO[0]: unit quad corners, VBO[1]: per-instance primitive data
+    unsigned int VBO[2];
+
+    void add(PrimitiveType type, float s0, float s1, float s2, float s3,
+             float r, float g, float b, float a, float width) {
+        Primitive p = { { s0, s1, s2, s3 }, { r, g, b, a }, width, (float)type };
+        primitives.push_back(p);
+        dirty = true;
+    }
+
+    void createBuffers() {
+        // unit quad as a triangle strip
+        float corners[] = {
+            -1.0f, -1.0f,
+             1.0f, -1.0f,
+            -1.0f,  1.0f,
+             1.0f,  1.0f
+        };
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(2, VBO);
+
+        glBindVertexArray(VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+        glEnableVertexAttribArray(0);
+
+        // per-instance attributes (advance once per quad)
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Primitive), (void*)offsetof(Primitive, shape));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Primitive), (void*)offsetof(Primitive, color));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Primitive), (void*)offsetof(Primitive, width));
+        for (int i = 1; i <= 3; i++) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribDivisor(i, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(0);
+    }
+
+    void updateBuffers() {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+        if (primitives.size() > capacity) {
+            // grow the instance buffer, keeping some headroom for later additions
+            capacity = primitives.size() * 2;
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Primitive), 0, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, primitives.size() * sizeof(Primitive), primitives.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        dirty = false;
+    }
+};
+
+
+#endif
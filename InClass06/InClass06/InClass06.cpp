@@ -8,7 +8,11 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <cmath>
+#include <vector>
 #include <shader.h>
+#include "job_system.h"
+#include "scene_graph.h"
+#include "gpu_animation.h"
 
 using namespace std;
 
@@ -16,11 +20,13 @@ using namespace std;
 GLFWwindow *glAllInit();
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow *window, int key, int scancode, int action , int mods);
+void buildDrawPackets();
 void render();
 
 // Global variables
 GLFWwindow *window = NULL;
 Shader *globalShader = NULL;
+Shader *animatedShader = NULL;
 unsigned int SCR_WIDTH = 600;
 unsigned int SCR_HEIGHT = 600;
 unsigned int VBO, VAO, EBO;
@@ -38,6 +44,33 @@ unsigned int indices[] = {
 float speed1 = glm::radians(90.0f);  // 90 degrees/sec for the first rectangle
 float speed2 = glm::radians(180.0f);  // 45 degrees/sec for the second rectangle
 
+// hierarchy: arm (speed1) -> rectangle 1
+//                         -> joint at the tip of rectangle 1 (speed2) -> rectangle 2
+// numArms > 1: copies of the arm on a grid (e.g. 100000 to load every core)
+int numArms = 1;
+SceneGraph *scene = NULL;
+vector<int> arms, joints;
+
+// per frame: animation, scene->update(), culling and packet building run on the
+// job system, the context thread only submits the visible packets
+struct Drawable {
+    int node;
+    float color[4];
+};
+struct DrawPacket {
+    float transform[16];
+    float color[4];
+};
+const float MIN_PIXELS = 0.5f;         // rectangles smaller than this on screen are skipped
+JobSystem *jobs = NULL;
+vector<Drawable> drawables;
+vector<DrawPacket> packets;            // packets[i] for drawables[i]
+vector<unsigned char> visible;         // packets[i] is to be drawn
+
+// GPU animation: the same hierarchy evaluated in animated.vs from a single time uniform
+bool gpuAnimation = false;
+GpuAnimation *animation = NULL;
+
 int main()
 {
     window = glAllInit();
@@ -64,6 +97,53 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    // scene graph: only the rotations change per frame
+    jobs = new JobSystem();
+    scene = new SceneGraph();
+    int grid = (int)ceil(sqrt((float)numArms));
+    float cell = 2.0f / grid;
+    for (int i = 0; i < numArms; i++) {
+        int arm = scene->addNode();
+        scene->setTranslation(arm, -1.0f + cell * (i % grid + 0.5f), -1.0f + cell * (i / grid + 0.5f), 0.0f);
+        scene->setScale(arm, 1.0f / grid, 1.0f / grid, 1.0f);
+        int rect1 = scene->addNode(arm);
+        scene->setScale(rect1, 0.5f, 0.05f, 0.5f);
+        scene->setOffset(rect1, 0.5f, 0.0f, 0.0f);
+        int joint = scene->addNode(arm);
+        scene->setTranslation(joint, 0.5f, 0.0f, 0.0f);
+        int rect2 = scene->addNode(joint);
+        scene->setScale(rect2, 0.2f, 0.05f, 1.0f);
+        scene->setOffset(rect2, 0.5f, 0.0f, 0.0f);
+        arms.push_back(arm);
+        joints.push_back(joint);
+        Drawable d1 = { rect1, { 1.0f, 0.0f, 0.0f, 1.0f } };
+        Drawable d2 = { rect2, { 1.0f, 1.0f, 0.0f, 1.0f } };
+        drawables.push_back(d1);
+        drawables.push_back(d2);
+    }
+    packets.resize(drawables.size());
+    visible.resize(drawables.size());
+
+    if (gpuAnimation) {
+        // speeds instead of angles: nothing is updated on the CPU afterwards
+        animatedShader = new Shader("animated.vs", "animated.fs");
+        animation = new GpuAnimation();
+        int gArm = animation->addNode();
+        animation->setSpin(gArm, speed1);
+        int gRect1 = animation->addNode(gArm);
+        animation->setScale(gRect1, 0.5f, 0.05f, 0.5f);
+        animation->setOffset(gRect1, 0.5f, 0.0f, 0.0f);
+        int gJoint = animation->addNode(gArm);
+        animation->setTranslation(gJoint, 0.5f, 0.0f, 0.0f);
+        animation->setSpin(gJoint, speed2);
+        int gRect2 = animation->addNode(gJoint);
+        animation->setScale(gRect2, 0.2f, 0.05f, 1.0f);
+        animation->setOffset(gRect2, 0.5f, 0.0f, 0.0f);
+        animation->addInstance(gRect1, 1.0f, 0.0f, 0.0f, 1.0f);
+        animation->addInstance(gRect2, 1.0f, 1.0f, 0.0f, 1.0f);
+        animation->attach(VAO);
+    }
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
@@ -76,6 +156,7 @@ int main()
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    delete jobs;
     
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -124,45 +205,62 @@ GLFWwindow *glAllInit()
 void render()
 {
     float currentTime = glfwGetTime();
-    glm::mat4 transform;
     
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
+
+    if (gpuAnimation) {
+        // both rectangles in one instanced draw, transforms evaluated in animated.vs
+        animation->draw(animatedShader, VAO, 6, currentTime);
+        glfwSwapBuffers(window);
+        return;
+    }
     
+    // animate the joints, the rectangles follow their parents
+    jobs->parallelFor(0, numArms, 1024, [currentTime](int first, int last) {
+        for (int i = first; i < last; i++) {
+            scene->setRotation(arms[i], speed1 * currentTime, 0.0f, 0.0f, 1.0f);
+            scene->setRotation(joints[i], speed2 * currentTime, 0.0f, 0.0f, 1.0f);
+        }
+    });
+    scene->update(jobs);
+    buildDrawPackets();
+
+    // GL calls only on this (the context) thread
     globalShader->use();
-    
-    // 1st rectangle
-    transform = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    transform = glm::rotate(transform, speed1 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
-    transform = glm::scale(transform, glm::vec3(0.5f, 0.05f, 0.5f));
-    transform = glm::translate(transform, glm::vec3(0.5f, 0.0f, 0.0f));
-    
-    // pass the uniform variables
-    globalShader->setMat4("transform", transform);
-    globalShader->setVec4("inColor", 1.0f, 0.0f, 0.0f, 1.0f);
-    
-    // draw rectangle
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    
-    // 2nd rectangle
-    transform = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    transform = glm::rotate(transform, speed1 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
-    transform = glm::translate(transform, glm::vec3(0.5f, 0.0f, 0.0f));
-    transform = glm::rotate(transform, speed2 * currentTime, glm::vec3(0.0f, 0.0f, 1.0f));
-    transform = glm::scale(transform, glm::vec3(0.2f, 0.05f, 1.0f));
-    transform = glm::translate(transform, glm::vec3(0.5f, 0.0f, 0.0f));
-    // pass the uniform variables
-    globalShader->setMat4("transform", transform);
-    globalShader->setVec4("inColor", 1.0f, 1.0f, 0.0f, 1.0f);
-    
-    // draw rectangle
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (!visible[i]) continue;
+        const DrawPacket &p = packets[i];
+        globalShader->setMat4("transform", glm::make_mat4(p.transform));
+        globalShader->setVec4("inColor", p.color[0], p.color[1], p.color[2], p.color[3]);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
     
     glfwSwapBuffers(window);
 }
 
+// culls the drawables against the viewport (bounds of the transformed unit square)
+// and fills the packets of the visible ones, in parallel
+void buildDrawPackets()
+{
+    jobs->parallelFor(0, (int)drawables.size(), 512, [](int first, int last) {
+        for (int i = first; i < last; i++) {
+            const float* m = scene->world(drawables[i].node);
+            float ex = 0.5f * (fabs(m[0]) + fabs(m[4]));
+            float ey = 0.5f * (fabs(m[1]) + fabs(m[5]));
+            bool inside = fabs(m[12]) - ex <= 1.0f && fabs(m[13]) - ey <= 1.0f;
+            // detail culling: extent in pixels (NDC is 2 units wide)
+            bool bigEnough = ex * SCR_WIDTH >= MIN_PIXELS || ey * SCR_HEIGHT >= MIN_PIXELS;
+            visible[i] = inside && bigEnough;
+            if (!visible[i]) continue;
+            DrawPacket &p = packets[i];
+            for (int k = 0; k < 16; k++) p.transform[k] = m[k];
+            for (int k = 0; k < 4; k++) p.color[k] = drawables[i].color[k];
+        }
+    });
+}
+
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
@@ -1,8 +1,8 @@
 #version 330 core
+in vec4 instColor;
 out vec4 FragColor;
-uniform vec4 inColor;
 
 void main()
 {
-    FragColor = inColor;
+	FragColor = instColor;
 }
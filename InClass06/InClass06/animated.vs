@@ -0,0 +1,34 @@
+#version 330 core
+
+// transform chain evaluated from time (see gpu_animation.h)
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in int aNode;      // node the instance is attached to
+layout (location = 2) in vec4 aColor;
+
+uniform samplerBuffer nodes;   // 3 texels per node: (translation, speed), (scale, phase), (offset, parent)
+uniform float time;
+
+out vec4 instColor;
+
+const int MAX_DEPTH = 16;   // GpuAnimation::MAX_DEPTH, addNode() refuses deeper nodes
+
+void main()
+{
+	vec3 p = aPos;
+	int node = aNode;
+	for (int depth = 0; depth < MAX_DEPTH && node >= 0; depth++) {
+		vec4 t0 = texelFetch(nodes, node * 3);
+		vec4 t1 = texelFetch(nodes, node * 3 + 1);
+		vec4 t2 = texelFetch(nodes, node * 3 + 2);
+
+		// translate(t) * rotateZ(speed * time + phase) * scale(s) * translate(offset)
+		float angle = t0.w * time + t1.w;
+		float c = cos(angle), s = sin(angle);
+		p = (p + t2.xyz) * t1.xyz;
+		p = vec3(c * p.x - s * p.y, s * p.x + c * p.y, p.z) + t0.xyz;
+
+		node = int(t2.w);
+	}
+	gl_Position = vec4(p, 1.0);
+	instColor = aColor;
+}
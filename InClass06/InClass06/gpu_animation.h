@@ -0,0 +1,168 @@
+#pragma once
+
+// GpuAnimation
+//
+// Time-driven hierarchies evaluated entirely in the vertex shader (animated.vs).
+//
+//   - every node stores translation, scale, pivot offset, angular speed, phase
+//     and its parent index in a texture buffer (3 RGBA32F texels per node)
+//   - local transform at time t = translate(t) * rotateZ(speed * t + phase)
+//     * scale(s) * translate(offset), the shader walks from the instance's node
+//     up to the root applying each one to the vertex
+//   - one instance per drawn node (node index + color), all of them are drawn
+//     with a single glDrawElementsInstanced()
+//
+// Per frame the CPU only sets the "time" uniform, whatever the number of objects.
+// The shader walks at most MAX_DEPTH nodes: addNode() refuses (returns -1, with an
+// error) a node whose chain to the root would be longer; keep such a hierarchy on
+// the CPU scene graph.
+// Nodes must be set up before the first draw(); later changes are re-uploaded.
+//
+// Vertex shader: the location (0: position (vec3), 1: node (int), 2: color (vec4))
+
+#ifndef GPU_ANIMATION_H
+#define GPU_ANIMATION_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <iostream>
+#include "shader.h"
+
+using namespace std;
+
+class GpuAnimation {
+
+public:
+    static const int MAX_DEPTH = 16;     // same as in animated.vs: nodes from an instance's node to the root
+
+    GpuAnimation() {
+        dirty = true;
+        glGenBuffers(1, &nodeBuffer);
+        glGenTextures(1, &nodeTexture);
+        glGenBuffers(1, &instanceBuffer);
+    }
+
+    ~GpuAnimation() {
+        glDeleteTextures(1, &nodeTexture);
+        glDeleteBuffers(1, &nodeBuffer);
+        glDeleteBuffers(1, &instanceBuffer);
+    }
+
+    // returns the index of the new node (identity transform, not spinning), -1 if it would be deeper than MAX_DEPTH
+    int addNode(int parent = -1) {
+        int n = (int)(nodes.size() / FLOATS_PER_NODE);
+        if (parent >= n) {
+            cout << "GpuAnimation::addNode error: parent " << parent << " must be added before its children" << endl;
+            parent = -1;
+        }
+        int depth = (parent >= 0) ? depths[parent] + 1 : 1;
+        if (depth > MAX_DEPTH) {
+            cout << "GpuAnimation::addNode error: node under " << parent << " would be at depth " << depth
+                 << ", animated.vs evaluates at most " << MAX_DEPTH << endl;
+            return -1;
+        }
+        depths.push_back(depth);
+        float node[FLOATS_PER_NODE] = {
+            0.0f, 0.0f, 0.0f, 0.0f,          // translation, angular speed
+            1.0f, 1.0f, 1.0f, 0.0f,          // scale, phase
+            0.0f, 0.0f, 0.0f, (float)parent  // offset, parent
+        };
+        nodes.insert(nodes.end(), node, node + FLOATS_PER_NODE);
+        dirty = true;
+        return n;
+    }
+
+    // calls with node -1 (a refused addNode()) are ignored
+    void setTranslation(int node, float x, float y, float z) { set(node, 0, x, y, z); }
+    void setScale(int node, float x, float y, float z) { set(node, 4, x, y, z); }
+    void setOffset(int node, float x, float y, float z) { set(node, 8, x, y, z); }
+
+    // rotation around z: angle = speed * time + phase (radians)
+    void setSpin(int node, float speed, float phase = 0.0f) {
+        if (!valid(node)) return;
+        nodes[node * FLOATS_PER_NODE + 3] = speed;
+        nodes[node * FLOATS_PER_NODE + 7] = phase;
+        dirty = true;
+    }
+
+    // draws the geometry of the VAO at this node
+    void addInstance(int node, float r, float g, float b, float a) {
+        if (!valid(node)) return;
+        Instance inst = { node, { r, g, b, a } };
+        instances.push_back(inst);
+        dirty = true;
+    }
+
+    // adds the per-instance attributes (locations 1 and 2) to the VAO of the geometry
+    void attach(unsigned int VAO) {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glVertexAttribIPointer(1, 1, GL_INT, sizeof(Instance), (void*)0);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)sizeof(int));
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribDivisor(2, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // the VAO must have been attach()ed
+    void draw(Shader *shader, unsigned int VAO, int numIndices, float time) {
+        if (instances.empty()) return;
+        if (dirty) upload();
+
+        shader->use();
+        shader->setFloat("time", time);
+        shader->setInt("nodes", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, nodeTexture);
+
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0, (GLsizei)instances.size());
+        glBindVertexArray(0);
+    }
+
+private:
+    static const int FLOATS_PER_NODE = 12;
+
+    struct Instance {
+        int node;
+        float color[4];
+    };
+
+    vector<float> nodes;
+    vector<int> depths;      // per node: # of nodes up to the root, itself included
+    vector<Instance> instances;
+    bool dirty;              // nodes or instances changed since the last upload
+
+    unsigned int nodeBuffer;
+    unsigned int nodeTexture;
+    unsigned int instanceBuffer;
+
+    bool valid(int node) { return node >= 0 && node < (int)depths.size(); }
+
+    void set(int node, int first, float x, float y, float z) {
+        if (!valid(node)) return;
+        float* p = &nodes[node * FLOATS_PER_NODE + first];
+        p[0] = x; p[1] = y; p[2] = z;
+        dirty = true;
+    }
+
+    void upload() {
+        glBindBuffer(GL_TEXTURE_BUFFER, nodeBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, nodes.size() * sizeof(float), nodes.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, nodeTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, nodeBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        dirty = false;
+    }
+};
+
+
+#endif
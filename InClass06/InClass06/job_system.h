@@ -0,0 +1,180 @@
+#pragma once
+
+// JobSystem
+//
+// Work-stealing task scheduler for the CPU side of a frame (no GL calls in jobs,
+// GL submission stays on the context thread).
+//
+//   - one deque per thread (the calling thread is thread 0): a thread pushes and
+//     pops its own jobs at the back, idle threads steal the oldest job from the
+//     front of another deque
+//   - fork-join: run(counter, job) forks, wait(counter) joins; the waiting
+//     thread keeps executing jobs instead of blocking, so jobs can fork and
+//     wait on nested jobs
+//   - parallelFor(begin, end, grain, f): f(first, last) on chunks of at most
+//     grain items, returns when every chunk is done
+//   - the worker threads start with the first forked job: a program whose
+//     parallelFor() ranges all fit one chunk stays single threaded
+//
+// e.g.
+//   JobCounter counter;
+//   jobs->run(counter, [&]() { ... });
+//   jobs->wait(counter);
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+// # of unfinished jobs forked against it
+struct JobCounter {
+    atomic<int> pending;
+    JobCounter() : pending(0) {}
+};
+
+class JobSystem {
+
+public:
+    // numThreads: total including the calling thread (0: one per core)
+    JobSystem(unsigned int numThreads = 0) {
+        if (numThreads == 0) numThreads = thread::hardware_concurrency();
+        if (numThreads == 0) numThreads = 1;
+        quit = false;
+        numQueued = 0;
+        for (unsigned int i = 0; i < numThreads; i++) queues.push_back(new WorkQueue());
+        threadIndex() = 0;
+    }
+
+    ~JobSystem() {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+        for (size_t i = 0; i < queues.size(); i++) delete queues[i];
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int numThreads() { return (unsigned int)queues.size(); }
+
+    // forks a job; wait(counter) returns once it (and every other job of counter) is done
+    void run(JobCounter &counter, function<void()> job) {
+        call_once(started, &JobSystem::startWorkers, this);
+        counter.pending++;
+        WorkQueue* q = queues[threadIndex()];
+        {
+            lock_guard<mutex> lock(q->lock);
+            q->jobs.push_back(Job{ job, &counter });
+        }
+        // under wakeMutex: a worker between its predicate check and wait() can't miss it
+        lock_guard<mutex> lock(wakeMutex);
+        numQueued++;
+        wake.notify_one();
+    }
+
+    // joins: executes queued jobs (own ones first, then stolen) until counter reaches 0
+    void wait(JobCounter &counter) {
+        while (counter.pending.load() > 0) {
+            if (!executeOne(threadIndex())) this_thread::yield();
+        }
+    }
+
+    // f(first, last) for [begin, end) in chunks of at most grain items
+    void parallelFor(int begin, int end, int grain, const function<void(int, int)> &f) {
+        if (end <= begin) return;
+        if (grain < 1) grain = 1;
+        if (end - begin <= grain || numThreads() == 1) {
+            f(begin, end);
+            return;
+        }
+        JobCounter counter;
+        for (int first = begin; first < end; first += grain) {
+            int last = (first + grain < end) ? first + grain : end;
+            run(counter, [&f, first, last]() { f(first, last); });
+        }
+        wait(counter);
+    }
+
+private:
+    struct Job {
+        function<void()> task;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue {
+        mutex lock;
+        deque<Job> jobs;
+    };
+
+    vector<WorkQueue*> queues;      // queues[i]: jobs forked by thread i
+    vector<thread> workers;
+    once_flag started;              // workers are started by the first run()
+    atomic<int> numQueued;          // jobs in all queues, lets idle workers sleep; raised under wakeMutex
+    mutex wakeMutex;
+    condition_variable wake;
+    bool quit;
+
+    static unsigned int& threadIndex() {
+        thread_local unsigned int index = 0;
+        return index;
+    }
+
+    bool pop(unsigned int i, Job &job) {
+        WorkQueue* q = queues[i];
+        lock_guard<mutex> lock(q->lock);
+        if (q->jobs.empty()) return false;
+        job = q->jobs.back();       // newest: still hot in this thread's cache
+        q->jobs.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned int i, Job &job) {
+        WorkQueue* q = queues[i];
+        lock_guard<mutex> lock(q->lock);
+        if (q->jobs.empty()) return false;
+        job = q->jobs.front();      // oldest: usually the biggest piece of work
+        q->jobs.pop_front();
+        return true;
+    }
+
+    bool executeOne(unsigned int self) {
+        Job job;
+        bool found = pop(self, job);
+        for (unsigned int k = 1; !found && k < queues.size(); k++) {
+            found = steal((self + k) % queues.size(), job);
+        }
+        if (!found) return false;
+        numQueued--;
+        job.task();
+        job.counter->pending--;
+        return true;
+    }
+
+    void startWorkers() {
+        for (unsigned int i = 1; i < queues.size(); i++) workers.push_back(thread(&JobSystem::workerLoop, this, i));
+    }
+
+    void workerLoop(unsigned int index) {
+        threadIndex() = index;
+        while (true) {
+            if (executeOne(index)) continue;
+            unique_lock<mutex> lock(wakeMutex);
+            wake.wait(lock, [this]() { return quit || numQueued.load() > 0; });
+            if (quit) return;
+        }
+    }
+};
+
+
+#endif
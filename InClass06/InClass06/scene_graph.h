@@ -0,0 +1,222 @@
+#pragma once
+
+// SceneGraph
+//
+// Transform hierarchy stored as structure of arrays:
+//
+//   - node i has a parent index < i (-1: root), so the arrays are always in
+//     topological order and one forward pass updates the whole hierarchy
+//   - local transform = translate(t) * rotate(q) * scale(s) * translate(offset),
+//     each component in its own contiguous array
+//   - setters only mark the node dirty; update() recomputes a world matrix when
+//     the node or one of its ancestors changed and skips clean subtrees
+//   - world matrices are contiguous column-major float[16] (glUniformMatrix4fv
+//     ready) and multiplied with SSE when available
+//   - update(jobs) processes the hierarchy one depth level at a time, the nodes
+//     of a level in parallel (their parents are all in the previous levels)
+//
+// e.g. InClass06: arm (rotating) -> rectangle 1
+//                                -> joint (translated, rotating) -> rectangle 2
+
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <atomic>
+#include "job_system.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_GRAPH_SSE
+#endif
+
+using namespace std;
+
+class SceneGraph {
+
+public:
+    static const int PARALLEL_MIN_NODES = 1024;  // smaller graphs: update() on the calling thread
+    static const int PARALLEL_GRAIN = 256;       // nodes per job
+
+    SceneGraph() { levelsValid = false; }
+
+    // returns the index of the new node (identity local transform)
+    int addNode(int parent = -1) {
+        int n = size();
+        if (parent >= n) {
+            cout << "SceneGraph::addNode error: parent " << parent << " must be added before its children" << endl;
+            parent = -1;
+        }
+        parents.push_back(parent);
+        depths.push_back(parent < 0 ? 0 : depths[parent] + 1);
+        levelsValid = false;
+        tx.push_back(0.0f); ty.push_back(0.0f); tz.push_back(0.0f);
+        qx.push_back(0.0f); qy.push_back(0.0f); qz.push_back(0.0f); qw.push_back(1.0f);
+        sx.push_back(1.0f); sy.push_back(1.0f); sz.push_back(1.0f);
+        ox.push_back(0.0f); oy.push_back(0.0f); oz.push_back(0.0f);
+        dirty.push_back(1);
+        changed.push_back(0);
+        for (int k = 0; k < 16; k++) worlds.push_back((k % 5 == 0) ? 1.0f : 0.0f);
+        return n;
+    }
+
+    int size() { return (int)parents.size(); }
+    int parent(int node) { return parents[node]; }
+
+    void setTranslation(int node, float x, float y, float z) {
+        tx[node] = x; ty[node] = y; tz[node] = z;
+        dirty[node] = 1;
+    }
+
+    // angle in radians around (x, y, z)
+    void setRotation(int node, float angle, float x, float y, float z) {
+        float len = sqrt(x * x + y * y + z * z);
+        float s = (len > 0.0f) ? sin(angle * 0.5f) / len : 0.0f;
+        qx[node] = x * s; qy[node] = y * s; qz[node] = z * s;
+        qw[node] = cos(angle * 0.5f);
+        dirty[node] = 1;
+    }
+
+    void setScale(int node, float x, float y, float z) {
+        sx[node] = x; sy[node] = y; sz[node] = z;
+        dirty[node] = 1;
+    }
+
+    // applied before the scale: moves the geometry relative to the node's pivot
+    void setOffset(int node, float x, float y, float z) {
+        ox[node] = x; oy[node] = y; oz[node] = z;
+        dirty[node] = 1;
+    }
+
+    // recomputes the world matrices of the dirty nodes and their descendants,
+    // returns the number of matrices computed
+    int update() {
+        int n = size();
+        int numUpdated = 0;
+        for (int i = 0; i < n; i++) {
+            if (updateNode(i)) numUpdated++;
+        }
+        return numUpdated;
+    }
+
+    // same result, the nodes of each depth level are split across the job system
+    int update(JobSystem *jobs) {
+        if (jobs == NULL || size() < PARALLEL_MIN_NODES) return update();
+        if (!levelsValid) buildLevels();
+
+        atomic<int> numUpdated(0);
+        for (size_t l = 0; l + 1 < levelStarts.size(); l++) {
+            jobs->parallelFor(levelStarts[l], levelStarts[l + 1], PARALLEL_GRAIN, [this, &numUpdated](int first, int last) {
+                int count = 0;
+                for (int k = first; k < last; k++) {
+                    if (updateNode(levelNodes[k])) count++;
+                }
+                numUpdated += count;
+            });
+        }
+        return numUpdated;
+    }
+
+    // column-major 4x4 world matrix of the node (valid after update())
+    const float* world(int node) { return &worlds[node * 16]; }
+
+private:
+    vector<int> parents;
+    vector<int> depths;               // 0: root
+    vector<int> levelNodes;           // node indices sorted by depth
+    vector<int> levelStarts;          // level l: levelNodes[levelStarts[l] .. levelStarts[l + 1])
+    bool levelsValid;                 // levelNodes is up to date with the added nodes
+    // local transform components
+    vector<float> tx, ty, tz;         // translation
+    vector<float> qx, qy, qz, qw;     // rotation (unit quaternion)
+    vector<float> sx, sy, sz;         // scale
+    vector<float> ox, oy, oz;         // offset
+    vector<unsigned char> dirty;      // local transform changed since the last update()
+    vector<unsigned char> changed;    // world matrix recomputed by the current update()
+    vector<float> worlds;             // 16 floats per node
+
+    // returns true when the world matrix of node i was recomputed
+    bool updateNode(int i) {
+        int p = parents[i];
+        bool parentChanged = (p >= 0) && changed[p];
+        if (!dirty[i] && !parentChanged) {
+            changed[i] = 0;
+            return false;
+        }
+        float local[16];
+        localMatrix(i, local);
+        if (p < 0) {
+            for (int k = 0; k < 16; k++) worlds[i * 16 + k] = local[k];
+        }
+        else {
+            multiply(&worlds[p * 16], local, &worlds[i * 16]);
+        }
+        dirty[i] = 0;
+        changed[i] = 1;
+        return true;
+    }
+
+    // counting sort of the nodes by depth
+    void buildLevels() {
+        int n = size();
+        int numLevels = 0;
+        for (int i = 0; i < n; i++) {
+            if (depths[i] + 1 > numLevels) numLevels = depths[i] + 1;
+        }
+        levelStarts.assign(numLevels + 1, 0);
+        for (int i = 0; i < n; i++) levelStarts[depths[i] + 1]++;
+        for (int l = 0; l < numLevels; l++) levelStarts[l + 1] += levelStarts[l];
+        vector<int> next(levelStarts.begin(), levelStarts.end() - 1);
+        levelNodes.resize(n);
+        for (int i = 0; i < n; i++) levelNodes[next[depths[i]]++] = i;
+        levelsValid = true;
+    }
+
+    void localMatrix(int i, float m[16]) {
+        float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+        // rotation * scale
+        m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx[i];
+        m[1] = (2.0f * (x * y + z * w)) * sx[i];
+        m[2] = (2.0f * (x * z - y * w)) * sx[i];
+        m[3] = 0.0f;
+        m[4] = (2.0f * (x * y - z * w)) * sy[i];
+        m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy[i];
+        m[6] = (2.0f * (y * z + x * w)) * sy[i];
+        m[7] = 0.0f;
+        m[8] = (2.0f * (x * z + y * w)) * sz[i];
+        m[9] = (2.0f * (y * z - x * w)) * sz[i];
+        m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz[i];
+        m[11] = 0.0f;
+        // translation + (rotation * scale) * offset
+        m[12] = tx[i] + m[0] * ox[i] + m[4] * oy[i] + m[8] * oz[i];
+        m[13] = ty[i] + m[1] * ox[i] + m[5] * oy[i] + m[9] * oz[i];
+        m[14] = tz[i] + m[2] * ox[i] + m[6] * oy[i] + m[10] * oz[i];
+        m[15] = 1.0f;
+    }
+
+    // r = a * b (column-major)
+    static void multiply(const float* a, const float* b, float* r) {
+#ifdef SCENE_GRAPH_SSE
+        __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+        for (int c = 0; c < 4; c++) {
+            // column c of r = a * (column c of b)
+            __m128 col = _mm_mul_ps(a0, _mm_set1_ps(b[c * 4]));
+            col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(b[c * 4 + 1])));
+            col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(b[c * 4 + 2])));
+            col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(b[c * 4 + 3])));
+            _mm_storeu_ps(r + c * 4, col);
+        }
+#else
+        for (int c = 0; c < 4; c++) {
+            for (int row = 0; row < 4; row++) {
+                r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1]
+                    + a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+            }
+        }
+#endif
+    }
+};
+
+
+#endif
@@ -9,6 +9,7 @@
 #include <cmath>
 #include <shader.h>
 #include <arcball.h>
+#include "camera_input.h"
 
 
 
@@ -57,6 +58,8 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow *window, int key, int scancode, int action , int mods);
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow *window, double x, double y);
+void window_refresh_callback(GLFWwindow* window);
+bool needsRedraw();
 void render();
 
 // Global variables
@@ -72,6 +75,14 @@ float arcballSpeed = 0.2f;
 static Arcball camArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true );
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 bool arcballCamRot = true;
+CameraInput *cameraInput = NULL;    // owns the arcballs after glAllInit()
+
+// render on demand: a frame is drawn only when the camera, the window or the scene changed,
+// otherwise the loop sleeps in glfwWaitEventsTimeout()
+bool renderOnDemand = true;
+bool frameDirty = true;                  // set by resize, keys, ...; cleared by render()
+unsigned int drawnCameraVersion = 0;     // CameraState::version of the last frame drawn
+const double IDLE_TIMEOUT = 1.0;         // seconds
 
 // Color
 float Colors[] = {
@@ -85,6 +96,7 @@ float Colors[] = {
 int main()
 {
     mainWindow = glAllInit();
+    cameraInput = new CameraInput(&camArcBall, &modelArcBall, arcballSpeed);
     
     // shader loading and compile (by calling the constructor)
     globalShader = new Shader("global.vs", "global.fs");
@@ -112,12 +124,15 @@ int main()
     // render loop
     // -----------
     while (!glfwWindowShouldClose(mainWindow)) {
-        render();
-        glfwPollEvents();
+        if (!renderOnDemand || needsRedraw()) render();
+        // the input thread wakes the loop up with glfwPostEmptyEvent()
+        if (renderOnDemand) glfwWaitEventsTimeout(IDLE_TIMEOUT);
+        else glfwPollEvents();
     }
     
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    delete cameraInput;
     glfwTerminate();
     return 0;
 }
@@ -149,6 +164,7 @@ GLFWwindow *glAllInit()
     glfwSetKeyCallback(window, key_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
     
     // OpenGL states
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -167,12 +183,17 @@ GLFWwindow *glAllInit()
 }
 
 void render() {
+
+    // newest arcball state published by the input thread
+    const CameraState &camera = cameraInput->latest();
+    drawnCameraVersion = camera.version;
+    frameDirty = false;
     
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     view = glm::lookAt(glm::vec3(0.0f, 3.0f, 7.0f), glm::vec3(0.0f, 0.0f, 0.0f),
                        glm::vec3(0.0f, 1.0f, 0.0f));
-    view = view * camArcBall.createRotationMatrix();
+    view = view * camera.camRotation;
     
     globalShader->use();
     globalShader->setMat4("view", view);
@@ -189,7 +210,7 @@ void render() {
 
     // center cube
     model = glm::mat4(1.0f);
-    model = model * modelArcBall.createRotationMatrix();
+    model = model * camera.modelRotation;
     globalShader->setMat4("model", model);
     
     glfwSwapBuffers(mainWindow);
@@ -204,6 +225,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
     SCR_WIDTH = width;
     SCR_HEIGHT = height; 
+    frameDirty = true;
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -211,21 +233,26 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         glfwSetWindowShouldClose(window, true);
     }
     else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-        camArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
-        modelArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
+        cameraInput->reset(SCR_WIDTH, SCR_HEIGHT);
     }
 }
 
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
-    if (arcballCamRot)
-        camArcBall.mouseButtonCallback( window, button, action, mods );
-    else
-        modelArcBall.mouseButtonCallback( window, button, action, mods );
+    // queued for the input thread
+    cameraInput->mouseButton(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, button, action, mods);
 }
 
 void cursor_position_callback(GLFWwindow *window, double x, double y) {
-    if (arcballCamRot)
-        camArcBall.cursorCallback( window, x, y );
-    else
-        modelArcBall.cursorCallback( window, x, y );
+    // queued for the input thread
+    cameraInput->cursor(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, x, y);
+}
+
+// the window was exposed and its contents are lost (e.g. after being covered)
+void window_refresh_callback(GLFWwindow* window) {
+    frameDirty = true;
+}
+
+// true when the last frame drawn is out of date
+bool needsRedraw() {
+    return frameDirty || cameraInput->latest().version != drawnCameraVersion;
 }
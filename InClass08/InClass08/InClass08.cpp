@@ -10,6 +10,9 @@
 
 #include <shader.h>
 #include <arcball.h>
+#include "camera_input.h"
+#include "buffer_pool.h"
+#include "gpu_resource.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -22,40 +25,69 @@ static unsigned int texture; // Array of texture ids.
 class Cylinder {
 public:
 
+	static const int NUM_SIDES = 5;
+	static const int MAX_INSTANCES = 64;
+
 	// vertex position array
-	GLfloat vertices[60];
+	GLfloat vertices[NUM_SIDES * 12];
 
 	// normal array
-	GLfloat normals[60];
+	GLfloat normals[NUM_SIDES * 12];
 
 	// colour array
-	GLfloat colors[80];
+	GLfloat colors[NUM_SIDES * 16];
 
 	// texture coord array
 
-	GLfloat texCoords[40];
+	GLfloat texCoords[NUM_SIDES * 8];
 
 	// index array for glDrawElements()
-	// A cube requires 36 indices = 6 sides * 2 tris * 3 verts
+	// 2 tris * 3 verts per side
+
+	GLuint indices[NUM_SIDES * 6];
+
+	// owned (gpu_resource.h): deleting the cylinder frees them
+	GpuVertexArray VAO;
+	GpuBuffer VBO;
+	GpuBuffer EBO;
+
+	// per-instance (x, y, z, radius, height) at locations 4 and 5, read by both shaders:
+	// every copy added with addInstance() is drawn by the same call
+	GpuBuffer instanceVBO;
+	GLfloat instances[MAX_INSTANCES * 5];
+	int numInstances;
 
-	GLuint indices[30];
-	unsigned int VAO;
-	unsigned int VBO;
-	unsigned int EBO;
+	// pooled: the vertex block and the indices are ranges of shared buffers (buffer_pool.h),
+	// VBO/EBO are then left empty: the data is in the pools' buffers at the ranges' offsets
+	BufferRange vertexRange;
+	BufferRange indexRange;
 
 	unsigned int vSize = sizeof(vertices);
 	unsigned int nSize = sizeof(normals);
 	unsigned int cSize = sizeof(colors);
 	unsigned int tSize = sizeof(texCoords);
 
-	Cylinder() {
-		initBuffers();
+	// vertex pulling mode: procedural_cylinder.vs builds the NUM_SIDES sides from gl_VertexID,
+	// nothing is stored per vertex (the VAO only has the instance attributes)
+	bool procedural;
+
+	Cylinder(bool procedural = false, BufferPool* vertexPool = NULL, BufferPool* indexPool = NULL) {
+		this->procedural = procedural;
+		if (procedural) {
+			VAO.create("Cylinder");
+		}
+		else {
+			initBuffers(vertexPool, indexPool);
+		}
+		numInstances = 0;
+		initInstances();
+		addInstance(0.0f, 0.0f, 0.0f, 1.0f, 2.0f);
 	};
 
-	void initBuffers() {
-		double angle = 2 * M_PI / 5;
+	void initBuffers(BufferPool* vertexPool, BufferPool* indexPool) {
+		double angle = 2 * M_PI / NUM_SIDES;
 		double radius = 1.0f;
-		for (int i = 0; i < 5; i++) {
+		for (int i = 0; i < NUM_SIDES; i++) {
 			vertices[12 * i] = radius * cos(angle * i);
 			vertices[12 * i + 1] = -1;
 			vertices[12 * i + 2] = radius * sin(angle * i);
@@ -76,41 +108,58 @@ public:
 			indices[6 * i + 4] = 4 * i + 2;
 			indices[6 * i + 5] = 4 * i + 3;
 
-			texCoords[8 * i] = 0.2f * i;
+			texCoords[8 * i] = (float)i / NUM_SIDES;
 			texCoords[8 * i + 1] = 0;
-			texCoords[8 * i + 2] = 0.2f * i;
+			texCoords[8 * i + 2] = (float)i / NUM_SIDES;
 			texCoords[8 * i + 3] = 1;
-			texCoords[8 * i + 4] = 0.2f * (i + 1);
+			texCoords[8 * i + 4] = (float)(i + 1) / NUM_SIDES;
 			texCoords[8 * i + 5] = 0;
-			texCoords[8 * i + 6] = 0.2f * (i + 1);
+			texCoords[8 * i + 6] = (float)(i + 1) / NUM_SIDES;
 			texCoords[8 * i + 7] = 1;
 
 
 		}
 
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		glBindVertexArray(VAO);
+		VAO.create("Cylinder");
+		glBindVertexArray(VAO.id());
+
+		size_t base = 0;     // byte offset of the vertex block in the vertex buffer
+		unsigned int indexBuffer;
+		if (vertexPool && indexPool) {
+			vertexPool->allocate(vSize + nSize + cSize + tSize, vertexRange);
+			indexPool->allocate(sizeof(indices), indexRange);
+			indexBuffer = indexRange.buffer();
+			base = vertexRange.offset();
+			glBindBuffer(GL_ARRAY_BUFFER, vertexRange.buffer());
+		}
+		else {
+			VBO.create("Cylinder");
+			EBO.create("Cylinder");
+			indexBuffer = EBO.id();
+			glBindBuffer(GL_ARRAY_BUFFER, VBO.id());
+			glBufferData(GL_ARRAY_BUFFER, vSize + nSize + cSize + tSize, 0, GL_STATIC_DRAW); // reserve space
+			VBO.setSize(vSize + nSize + cSize + tSize);
+			EBO.setSize(sizeof(indices));
+		}
 
 		// copy vertex attrib data to VBO
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, vSize + nSize + cSize + tSize, 0, GL_STATIC_DRAW); // reserve space
-		glBufferSubData(GL_ARRAY_BUFFER, 0, vSize, vertices);                  // copy verts at offset 0
-		glBufferSubData(GL_ARRAY_BUFFER, vSize, nSize, normals);               // copy norms after verts
-		glBufferSubData(GL_ARRAY_BUFFER, vSize + nSize, cSize, colors);          // copy cols after norms
-		glBufferSubData(GL_ARRAY_BUFFER, vSize + nSize + cSize, tSize, texCoords); // copy texs after cols
+		glBufferSubData(GL_ARRAY_BUFFER, base, vSize, vertices);                  // copy verts at offset 0
+		glBufferSubData(GL_ARRAY_BUFFER, base + vSize, nSize, normals);               // copy norms after verts
+		glBufferSubData(GL_ARRAY_BUFFER, base + vSize + nSize, cSize, colors);          // copy cols after norms
+		glBufferSubData(GL_ARRAY_BUFFER, base + vSize + nSize + cSize, tSize, texCoords); // copy texs after cols
 
 		// copy index data to EBO
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		if (indexRange.valid())
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexRange.offset(), sizeof(indices), indices);
+		else
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
 		// attribute position initialization
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);  // position attrib
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)vSize); // normal attrib
-		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(vSize + nSize)); //color attrib
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(vSize + nSize + cSize)); // tex coord
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)base);  // position attrib
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(base + vSize)); // normal attrib
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(base + vSize + nSize)); //color attrib
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(base + vSize + nSize + cSize)); // tex coord
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
 		glEnableVertexAttribArray(2);
@@ -120,10 +169,45 @@ public:
 		glBindVertexArray(0);
 	};
 
+	// instance buffer of the VAO, shared by the mesh and the procedural path
+	void initInstances() {
+		instanceVBO.create("Cylinder");
+		glBindVertexArray(VAO.id());
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO.id());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(instances), 0, GL_DYNAMIC_DRAW);
+		instanceVBO.setSize(sizeof(instances));
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);                          // offset
+		glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float))); // radius, height
+		glEnableVertexAttribArray(4);
+		glEnableVertexAttribArray(5);
+		glVertexAttribDivisor(4, 1);
+		glVertexAttribDivisor(5, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	// one more copy drawn by the same call
+	void addInstance(float x, float y, float z, float radius, float height) {
+		if (numInstances >= MAX_INSTANCES) return;
+		float* p = &instances[numInstances * 5];
+		p[0] = x; p[1] = y; p[2] = z;
+		p[3] = radius; p[4] = height;
+		numInstances++;
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO.id());
+		glBufferSubData(GL_ARRAY_BUFFER, 0, numInstances * 5 * sizeof(float), instances);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
 	void draw(Shader* shader) {
 		shader->use();
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 30, GL_UNSIGNED_INT, 0);
+		glBindVertexArray(VAO.id());
+		if (procedural) {
+			shader->setInt("numSides", NUM_SIDES);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, NUM_SIDES * 6, numInstances);
+		}
+		else {
+			glDrawElementsInstanced(GL_TRIANGLES, NUM_SIDES * 6, GL_UNSIGNED_INT, (void*)(size_t)indexRange.offset(), numInstances);
+		}
 		glBindVertexArray(0);
 	};
 };
@@ -134,6 +218,8 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double x, double y);
+void window_refresh_callback(GLFWwindow* window);
+bool needsRedraw();
 void getTexture();
 void render();
 
@@ -151,6 +237,22 @@ glm::vec3 camUp(0.0f, 1.0f, 0.0f);
 // for arcball
 float arcballSpeed = 0.2f;
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
+CameraInput *cameraInput = NULL;    // owns the arcball after glAllInit()
+
+// render on demand: a frame is drawn only when the camera, the window or the scene changed,
+// otherwise the loop sleeps in glfwWaitEventsTimeout()
+bool renderOnDemand = true;
+bool frameDirty = true;                  // set by resize, keys, ...; cleared by render()
+unsigned int drawnCameraVersion = 0;     // CameraState::version of the last frame drawn
+const double IDLE_TIMEOUT = 1.0;         // seconds
+
+// vertex pulling: generate the cylinder in the vertex shader from gl_VertexID
+bool proceduralMesh = false;
+
+// mesh vertices and indices are ranges of a few shared buffers (no glGenBuffers per mesh)
+bool pooledMeshes = true;
+BufferPool *vertexPool = NULL;
+BufferPool *indexPool = NULL;
 
 // for texture
 
@@ -159,9 +261,13 @@ static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 int main()
 {
 	mainWindow = glAllInit();
+	cameraInput = new CameraInput(NULL, &modelArcBall, arcballSpeed);
 
 	// shader loading and compile (by calling the constructor)
-	globalShader = new Shader("global.vs", "global.fs");
+	if (proceduralMesh)
+		globalShader = new Shader("procedural_cylinder.vs", "global.fs");
+	else
+		globalShader = new Shader("global.vs", "global.fs");
 
 	// projection and view matrix
 	globalShader->use();
@@ -175,13 +281,24 @@ int main()
 	getTexture();
 
 	// create a cube
-	cylinder = new Cylinder();
+	if (pooledMeshes) {
+		vertexPool = new BufferPool("vertices", 64 << 10);
+		indexPool = new BufferPool("indices", 64 << 10);
+	}
+	cylinder = new Cylinder(proceduralMesh, vertexPool, indexPool);
 
 	while (!glfwWindowShouldClose(mainWindow)) {
-		render();
-		glfwPollEvents();
+		if (!renderOnDemand || needsRedraw()) render();
+		// the input thread wakes the loop up with glfwPostEmptyEvent()
+		if (renderOnDemand) glfwWaitEventsTimeout(IDLE_TIMEOUT);
+		else glfwPollEvents();
 	}
 
+	// GL objects go before the context
+	delete cylinder;
+	delete vertexPool;      // after the meshes that hold their ranges
+	delete indexPool;
+	delete cameraInput;
 	glfwTerminate();
 	return 0;
 }
@@ -213,6 +330,7 @@ GLFWwindow* glAllInit()
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetCursorPosCallback(window, cursor_position_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
 	// OpenGL states
 	glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -239,6 +357,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
+	frameDirty = true;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -246,16 +365,17 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		glfwSetWindowShouldClose(window, true);
 	}
 	else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-		modelArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
+		cameraInput->reset(SCR_WIDTH, SCR_HEIGHT);
 	}
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-	modelArcBall.mouseButtonCallback(window, button, action, mods);
+	// queued for the input thread
+	cameraInput->mouseButton(CameraInput::MODEL, button, action, mods);
 }
 
 void cursor_position_callback(GLFWwindow* window, double x, double y) {
-	modelArcBall.cursorCallback(window, x, y);
+	cameraInput->cursor(CameraInput::MODEL, x, y);
 }
 
 void getTexture() {
@@ -295,9 +415,14 @@ void getTexture() {
 
 void render() {
 
+	// newest arcball state published by the input thread
+	const CameraState &camera = cameraInput->latest();
+	drawnCameraVersion = camera.version;
+	frameDirty = false;
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	model = modelArcBall.createRotationMatrix();
+	model = camera.modelRotation;
 
 	globalShader->use();
 	globalShader->setMat4("model", model);
@@ -307,4 +432,14 @@ void render() {
 	cylinder->draw(globalShader);
 
 	glfwSwapBuffers(mainWindow);
-}
\ No newline at end of file
+}
+
+// the window was exposed and its contents are lost (e.g. after being covered)
+void window_refresh_callback(GLFWwindow* window) {
+	frameDirty = true;
+}
+
+// true when the last frame drawn is out of date
+bool needsRedraw() {
+	return frameDirty || cameraInput->latest().version != drawnCameraVersion;
+}
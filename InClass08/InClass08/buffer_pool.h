@@ -0,0 +1,263 @@
+#pragma once
+
+// BufferPool
+//
+// Suballocates vertex and index ranges out of a few large GL buffers (arenas),
+// so creating or deleting a mesh never calls glGenBuffers/glBufferData:
+//
+//   BufferPool pool("meshes");
+//   BufferRange range;
+//   pool.allocate(bytes, range);           // free list, no GL call
+//   pool.upload(range, data, bytes);       // glBufferSubData at range.offset()
+//   glBindBuffer(GL_ARRAY_BUFFER, range.buffer());
+//   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)(size_t)range.offset());
+//   ...                                    // ~BufferRange(): back to the free list
+//
+//   - best fit over the free blocks of each arena (by size), freed ranges are
+//     merged with their free neighbours, so the arenas don't fragment into
+//     unusable slivers
+//   - a new arena (arenaSize, or the request if larger) only when no arena has
+//     room; arenas are kept once created
+//   - sizes are rounded up to ALIGNMENT, so every offset is aligned
+//   - uploads go through GL_COPY_WRITE_BUFFER: they never touch the buffer
+//     bindings of a VAO (e.g. the element array buffer)
+//
+// GL thread only. All ranges must be released before the pool is deleted.
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <GL/glew.h>
+#include <map>
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include "gpu_resource.h"
+
+using namespace std;
+
+class BufferPool;
+
+// one suballocated range, returned to its pool when destroyed
+class BufferRange {
+
+public:
+    BufferRange() : pool(NULL), arena(0), buf(0), off(0), bytes(0) {}
+
+    ~BufferRange() { release(); }
+
+    BufferRange(BufferRange &&other) noexcept : pool(NULL) { take(other); }
+
+    BufferRange& operator=(BufferRange &&other) noexcept {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    BufferRange(const BufferRange&) = delete;
+    BufferRange& operator=(const BufferRange&) = delete;
+
+    inline void release();
+
+    bool valid() const { return pool != NULL; }
+    unsigned int buffer() const { return buf; }     // GL buffer of the arena
+    unsigned int offset() const { return off; }     // bytes from the start of the arena
+    unsigned int size() const { return bytes; }     // rounded up to BufferPool::ALIGNMENT
+
+private:
+    friend class BufferPool;
+
+    BufferPool* pool;
+    int arena;
+    unsigned int buf, off, bytes;
+
+    void take(BufferRange &other) {
+        pool = other.pool;
+        arena = other.arena;
+        buf = other.buf;
+        off = other.off;
+        bytes = other.bytes;
+        other.pool = NULL;
+    }
+};
+
+class BufferPool {
+
+public:
+    static const unsigned int ARENA_SIZE = 4 << 20;    // 4 MB
+    static const unsigned int ALIGNMENT = 64;
+
+    BufferPool(const string &name, unsigned int arenaSize = ARENA_SIZE) {
+        this->name = name;
+        this->arenaSize = arenaSize;
+        usedBytes = 0;
+        numRanges = 0;
+    }
+
+    ~BufferPool() {
+        if (numRanges > 0)
+            cout << "BufferPool::~BufferPool error: " << numRanges << " ranges of " << name << " still in use" << endl;
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // false for size 0 (range is released either way)
+    bool allocate(unsigned int size, BufferRange &range) {
+        range.release();
+        if (size == 0) return false;
+        size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+        int a = 0;
+        unsigned int offset = 0;
+        for (; a < (int)arenas.size(); a++) {
+            if (take(*arenas[a], size, offset)) break;
+        }
+        if (a == (int)arenas.size()) {
+            addArena(size > arenaSize ? size : arenaSize);
+            take(*arenas[a], size, offset);
+        }
+
+        range.pool = this;
+        range.arena = a;
+        range.buf = arenas[a]->buffer.id();
+        range.off = offset;
+        range.bytes = size;
+        usedBytes += size;
+        numRanges++;
+        return true;
+    }
+
+    // data into range, starting at byte offset within the range
+    void upload(const BufferRange &range, const void* data, unsigned int size, unsigned int offset = 0) {
+        if (!range.valid() || offset + size > range.size()) {
+            cout << "BufferPool::upload error: " << size << " bytes at " << offset
+                 << " don't fit a range of " << range.size() << endl;
+            return;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, range.buffer());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.offset() + offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    unsigned int used() { return usedBytes; }
+    unsigned int ranges() { return numRanges; }
+
+    unsigned int reserved() {
+        unsigned int bytes = 0;
+        for (size_t a = 0; a < arenas.size(); a++) bytes += arenas[a]->size;
+        return bytes;
+    }
+
+    // largest block a single allocation could get without a new arena
+    unsigned int largestFree() {
+        unsigned int largest = 0;
+        for (size_t a = 0; a < arenas.size(); a++) {
+            if (!arenas[a]->bySize.empty() && arenas[a]->bySize.rbegin()->first > largest)
+                largest = arenas[a]->bySize.rbegin()->first;
+        }
+        return largest;
+    }
+
+    void report() {
+        size_t freeBlocks = 0;
+        for (size_t a = 0; a < arenas.size(); a++) freeBlocks += arenas[a]->byOffset.size();
+        cout << "BUFFER POOL " << name << ": " << numRanges << " ranges, " << usedBytes << " of " << reserved()
+             << " bytes in " << arenas.size() << " arenas, " << freeBlocks << " free blocks (largest "
+             << largestFree() << ")" << endl;
+    }
+
+private:
+    friend class BufferRange;
+
+    struct Arena {
+        GpuBuffer buffer;
+        unsigned int size;
+        map<unsigned int, unsigned int> byOffset;         // free blocks: offset -> size
+        multimap<unsigned int, unsigned int> bySize;      // the same blocks: size -> offset
+    };
+
+    string name;
+    unsigned int arenaSize;
+    vector<unique_ptr<Arena> > arenas;
+    unsigned int usedBytes;
+    unsigned int numRanges;
+
+    void addArena(unsigned int size) {
+        unique_ptr<Arena> arena(new Arena());
+        arena->buffer.create("BufferPool " + name);
+        arena->size = size;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, arena->buffer.id());
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        arena->buffer.setSize(size);
+        insertFree(*arena, 0, size);
+        arenas.push_back(move(arena));
+    }
+
+    // best fit: the smallest free block that holds size
+    static bool take(Arena &arena, unsigned int size, unsigned int &offset) {
+        multimap<unsigned int, unsigned int>::iterator it = arena.bySize.lower_bound(size);
+        if (it == arena.bySize.end()) return false;
+        unsigned int blockSize = it->first;
+        offset = it->second;
+        arena.bySize.erase(it);
+        arena.byOffset.erase(offset);
+        if (blockSize > size) insertFree(arena, offset + size, blockSize - size);
+        return true;
+    }
+
+    void recycle(BufferRange &range) {
+        Arena &arena = *arenas[range.arena];
+        unsigned int offset = range.off, size = range.bytes;
+
+        // merge with the free block right after and the one right before
+        map<unsigned int, unsigned int>::iterator next = arena.byOffset.lower_bound(offset);
+        if (next != arena.byOffset.end() && next->first == offset + size) {
+            size += next->second;
+            eraseFree(arena, next);
+        }
+        map<unsigned int, unsigned int>::iterator prev = arena.byOffset.lower_bound(offset);
+        if (prev != arena.byOffset.begin()) {
+            --prev;
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                eraseFree(arena, prev);
+            }
+        }
+        insertFree(arena, offset, size);
+
+        usedBytes -= range.bytes;
+        numRanges--;
+    }
+
+    static void insertFree(Arena &arena, unsigned int offset, unsigned int size) {
+        arena.byOffset[offset] = size;
+        arena.bySize.insert(make_pair(size, offset));
+    }
+
+    static void eraseFree(Arena &arena, map<unsigned int, unsigned int>::iterator block) {
+        pair<multimap<unsigned int, unsigned int>::iterator, multimap<unsigned int, unsigned int>::iterator> same =
+            arena.bySize.equal_range(block->second);
+        for (multimap<unsigned int, unsigned int>::iterator it = same.first; it != same.second; ++it) {
+            if (it->second == block->first) {
+                arena.bySize.erase(it);
+                break;
+            }
+        }
+        arena.byOffset.erase(block);
+    }
+};
+
+inline void BufferRange::release() {
+    if (!pool) return;
+    pool->recycle(*this);
+    pool = NULL;
+}
+
+
+#endif
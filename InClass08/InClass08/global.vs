@@ -3,6 +3,8 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec4 aColor;
 layout (location = 3) in vec2 aTexCoord;
+layout (location = 4) in vec3 aOffset;   // per instance
+layout (location = 5) in vec2 aSize;     // per instance: radius, height
 
 out vec4 toColor;
 out vec2 toTexCoord;
@@ -13,7 +15,8 @@ uniform mat4 projection;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec3 pos = vec3(aPos.x * aSize.x, aPos.y * aSize.y / 2.0, aPos.z * aSize.x) + aOffset;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
     toColor = aColor;
     toTexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
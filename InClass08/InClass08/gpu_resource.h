@@ -0,0 +1,197 @@
+#pragma once
+
+// GPU resources
+//
+// Move-only owners of GL objects and a registry of everything they allocated:
+//
+//   GpuBuffer vbo;
+//   vbo.create("Cylinder");                // glGenBuffers + registered under the owner
+//   glBindBuffer(GL_ARRAY_BUFFER, vbo.id());
+//   glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+//   vbo.setSize(size);                     // bytes charged to the owner
+//   ...                                    // ~GpuBuffer(): glDeleteBuffers + unregistered
+//
+//   - GpuBuffer, GpuVertexArray, GpuTexture, GpuProgram: one object each, 0 when
+//     empty; moving transfers the object, copying is not allowed
+//   - adopt() takes over an object created elsewhere (e.g. a linked program)
+//   - GpuMemory keeps the current and peak bytes and the live objects by owner;
+//     report() prints them, anything still listed after the owners were deleted
+//     is a leak
+//
+// The sizes are what the program asked for (the driver may pad them).
+// GL thread only; handles must be released before the context is destroyed.
+
+#ifndef GPU_RESOURCE_H
+#define GPU_RESOURCE_H
+
+#include <GL/glew.h>
+#include <map>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+enum GpuResourceType { GPU_BUFFER, GPU_VERTEX_ARRAY, GPU_TEXTURE, GPU_PROGRAM, GPU_NUM_TYPES };
+
+class GpuMemory {
+
+public:
+    static void created(GpuResourceType type, unsigned int id, const string &owner) {
+        Allocation a = { type, owner, 0 };
+        instance().live[key(type, id)] = a;
+    }
+
+    static void resized(GpuResourceType type, unsigned int id, size_t bytes) {
+        GpuMemory &m = instance();
+        map<unsigned long long, Allocation>::iterator it = m.live.find(key(type, id));
+        if (it == m.live.end()) return;
+        m.current = m.current - it->second.bytes + bytes;
+        if (m.current > m.peak) m.peak = m.current;
+        it->second.bytes = bytes;
+    }
+
+    static void deleted(GpuResourceType type, unsigned int id) {
+        GpuMemory &m = instance();
+        map<unsigned long long, Allocation>::iterator it = m.live.find(key(type, id));
+        if (it == m.live.end()) return;
+        m.current -= it->second.bytes;
+        m.live.erase(it);
+    }
+
+    static size_t currentBytes() { return instance().current; }
+    static size_t peakBytes() { return instance().peak; }
+    static int numLive() { return (int)instance().live.size(); }
+
+    // bytes of a width x height image with components bytes per pixel (+1/3 for a full mip chain)
+    static size_t textureBytes(int width, int height, int components, bool mipmaps) {
+        size_t bytes = (size_t)width * height * components;
+        return mipmaps ? bytes + bytes / 3 : bytes;
+    }
+
+    static void report() {
+        GpuMemory &m = instance();
+        cout << fixed << setprecision(1);
+        static const char* typeNames[GPU_NUM_TYPES] = { "buffer", "vertex array", "texture", "program" };
+        cout << "GPU MEMORY: current " << kilobytes(m.current) << " KB, peak " << kilobytes(m.peak)
+             << " KB, " << m.live.size() << " live objects" << endl;
+
+        // live objects and bytes per owner and type
+        map<string, pair<int, size_t> > owners;
+        for (map<unsigned long long, Allocation>::iterator it = m.live.begin(); it != m.live.end(); ++it) {
+            const Allocation &a = it->second;
+            pair<int, size_t> &o = owners[a.owner + " (" + typeNames[a.type] + ")"];
+            o.first++;
+            o.second += a.bytes;
+        }
+        for (map<string, pair<int, size_t> >::iterator it = owners.begin(); it != owners.end(); ++it) {
+            cout << "  " << left << setw(36) << it->first << right << setw(6) << it->second.first
+                 << setw(12) << kilobytes(it->second.second) << " KB" << endl;
+        }
+        cout.unsetf(ios::fixed);
+    }
+
+private:
+    struct Allocation {
+        GpuResourceType type;
+        string owner;
+        size_t bytes;
+    };
+
+    map<unsigned long long, Allocation> live;    // by (type << 32) | id
+    size_t current, peak;
+
+    GpuMemory() : current(0), peak(0) {}
+
+    static GpuMemory& instance() {
+        static GpuMemory memory;
+        return memory;
+    }
+
+    static unsigned long long key(GpuResourceType type, unsigned int id) {
+        return ((unsigned long long)type << 32) | id;
+    }
+
+    static double kilobytes(size_t bytes) { return bytes / 1024.0; }
+};
+
+template <GpuResourceType TYPE>
+class GpuHandle {
+
+public:
+    GpuHandle() : handle(0) {}
+
+    ~GpuHandle() { reset(); }
+
+    GpuHandle(GpuHandle &&other) noexcept : handle(other.handle) { other.handle = 0; }
+
+    GpuHandle& operator=(GpuHandle &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = other.handle;
+            other.handle = 0;
+        }
+        return *this;
+    }
+
+    GpuHandle(const GpuHandle&) = delete;
+    GpuHandle& operator=(const GpuHandle&) = delete;
+
+    // a new object (the current one is deleted)
+    void create(const string &owner) {
+        adopt(generate(), owner);
+    }
+
+    // ownership of an existing object
+    void adopt(unsigned int id, const string &owner) {
+        reset();
+        handle = id;
+        if (handle) GpuMemory::created(TYPE, handle, owner);
+    }
+
+    void setSize(size_t bytes) {
+        if (handle) GpuMemory::resized(TYPE, handle, bytes);
+    }
+
+    void reset() {
+        if (!handle) return;
+        GpuMemory::deleted(TYPE, handle);
+        destroy(handle);
+        handle = 0;
+    }
+
+    unsigned int id() const { return handle; }
+
+private:
+    unsigned int handle;
+
+    static unsigned int generate() {
+        unsigned int id = 0;
+        switch (TYPE) {
+        case GPU_BUFFER: glGenBuffers(1, &id); break;
+        case GPU_VERTEX_ARRAY: glGenVertexArrays(1, &id); break;
+        case GPU_TEXTURE: glGenTextures(1, &id); break;
+        case GPU_PROGRAM: id = glCreateProgram(); break;
+        default: break;
+        }
+        return id;
+    }
+
+    static void destroy(unsigned int id) {
+        switch (TYPE) {
+        case GPU_BUFFER: glDeleteBuffers(1, &id); break;
+        case GPU_VERTEX_ARRAY: glDeleteVertexArrays(1, &id); break;
+        case GPU_TEXTURE: glDeleteTextures(1, &id); break;
+        case GPU_PROGRAM: glDeleteProgram(id); break;
+        default: break;
+        }
+    }
+};
+
+typedef GpuHandle<GPU_BUFFER> GpuBuffer;
+typedef GpuHandle<GPU_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuHandle<GPU_TEXTURE> GpuTexture;
+typedef GpuHandle<GPU_PROGRAM> GpuProgram;
+
+
+#endif
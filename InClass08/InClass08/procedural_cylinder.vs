@@ -0,0 +1,33 @@
+#version 330 core
+// Cylinder generated from gl_VertexID (see Cylinder procedural mode in InClass08.cpp)
+layout (location = 4) in vec3 aOffset;   // per instance (same instance buffer as the mesh path)
+layout (location = 5) in vec2 aSize;     // per instance: radius, height
+
+out vec4 toColor;
+out vec2 toTexCoord;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform int numSides;
+
+const float PI = 3.14159265358979;
+
+// the 6 vertices of one side: x: 0 = angle i, 1 = angle i + 1, y: 0 = bottom, 1 = top
+const vec2 corners[6] = vec2[6](
+    vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0)
+);
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID % 6];
+    int i = gl_VertexID / 6 + int(corner.x);
+    float angle = (2.0 * PI / float(numSides)) * float(i);
+
+    vec3 pos = vec3(aSize.x * cos(angle), (corner.y - 0.5) * aSize.y, aSize.x * sin(angle)) + aOffset;
+
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+    toColor = vec4(1.0);
+    toTexCoord = vec2(float(i) / float(numSides), corner.y);
+}
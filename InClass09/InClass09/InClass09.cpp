@@ -11,6 +11,9 @@
 
 #include <shader.h>
 #include <arcball.h>
+#include "camera_input.h"
+#include "profiler.h"
+#include "gpu_resource.h"
 #include <cube.h>
 #include "cone.h"
 
@@ -23,6 +26,9 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double x, double y);
+void window_refresh_callback(GLFWwindow* window);
+bool needsRedraw();
+glm::mat3 computeNormalMatrix(const glm::mat4& model);
 void render();
 
 // Global variables
@@ -40,6 +46,25 @@ float arcballSpeed = 0.2f;
 static Arcball camArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 bool arcballCamRot = true;
+CameraInput *cameraInput = NULL;    // owns the arcballs after glAllInit()
+
+// render on demand: a frame is drawn only when the camera, the window or the scene changed,
+// otherwise the loop sleeps in glfwWaitEventsTimeout()
+bool renderOnDemand = true;
+bool frameDirty = true;                  // set by resize, keys, ...; cleared by render()
+unsigned int drawnCameraVersion = 0;     // CameraState::version of the last frame drawn
+const double IDLE_TIMEOUT = 1.0;         // seconds
+
+// CPU/GPU zones of render(), the draws, buffer updates and shader construction,
+// written to trace.json (chrome://tracing) on exit
+bool profile = false;
+
+// live GPU objects by owner, current and peak bytes, printed on exit after the
+// scene is deleted (whatever is still listed leaked)
+bool gpuMemoryReport = false;
+
+// vertex pulling: generate the cone in the vertex shader from gl_VertexID
+bool proceduralMesh = false;
 
 // for camera
 glm::vec3 cameraPos(0.0f, 0.0f, 7.0f);
@@ -57,10 +82,18 @@ float specularPower = 64.0f;
 int main()
 {
 	mainWindow = glAllInit();
+	cameraInput = new CameraInput(&camArcBall, &modelArcBall, arcballSpeed);
+	Profiler::setEnabled(profile);
 
 	// shader loading and compile (by calling the constructor)
-	globalShader = new Shader("basic_lighting.vs", "basic_lighting.fs");
-	lampShader = new Shader("lamp.vs", "lamp.fs");
+	{
+		PROFILE_ZONE("Shader");
+		if (proceduralMesh)
+			globalShader = new Shader("procedural_cone.vs", "basic_lighting.fs");
+		else
+			globalShader = new Shader("basic_lighting.vs", "basic_lighting.fs");
+		lampShader = new Shader("lamp.vs", "lamp.fs");
+	}
 
 	// projection matrix
 	projection = glm::perspective(glm::radians(45.0f),
@@ -79,7 +112,8 @@ int main()
 	lampShader->setMat4("projection", projection);
 
 	// Cylinder and Cube initialization
-	cone = new Cone();
+	// the cone only builds the vertex streams basic_lighting.vs reads (no colors)
+	cone = new Cone(proceduralMesh, activeAttributeMask(globalShader->ID));
 	lamp = new Cube();
 
 	cout << "ARCBALL: camera rotation mode" << endl;
@@ -87,12 +121,23 @@ int main()
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(mainWindow)) {
-		render();
-		glfwPollEvents();
+		if (!renderOnDemand || needsRedraw()) render();
+		// the input thread wakes the loop up with glfwPostEmptyEvent()
+		if (renderOnDemand) glfwWaitEventsTimeout(IDLE_TIMEOUT);
+		else glfwPollEvents();
 	}
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
+	if (profile) Profiler::writeTrace("trace.json");
+
+	// GL objects go before the context
+	delete cone;
+	delete lamp;
+	delete globalShader;
+	delete lampShader;
+	if (gpuMemoryReport) GpuMemory::report();
+	delete cameraInput;
 	glfwTerminate();
 	return 0;
 }
@@ -124,6 +169,7 @@ GLFWwindow* glAllInit()
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetCursorPosCallback(window, cursor_position_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
 	// OpenGL states
 	glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -141,31 +187,53 @@ GLFWwindow* glAllInit()
 	return window;
 }
 
-void render() {
-
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	view = view * camArcBall.createRotationMatrix();
-
-	// cone object
-	globalShader->use();
-	globalShader->setMat4("view", view);
-	model = glm::mat4(1.0f);
-	model = model * modelArcBall.createRotationMatrix();
-	globalShader->setMat4("model", model);
-	cone->draw(globalShader);
+// normal matrix of model: its upper 3x3 if that is a pure rotation, otherwise the cofactor matrix
+glm::mat3 computeNormalMatrix(const glm::mat4& model) {
+	glm::mat3 m(model);
+	const float EPS = 1e-4f;
+	bool rigid = fabs(glm::dot(m[0], m[0]) - 1.0f) < EPS && fabs(glm::dot(m[1], m[1]) - 1.0f) < EPS
+		&& fabs(glm::dot(m[2], m[2]) - 1.0f) < EPS && fabs(glm::dot(m[0], m[1])) < EPS
+		&& fabs(glm::dot(m[1], m[2])) < EPS && fabs(glm::dot(m[2], m[0])) < EPS;
+	if (rigid) return m;
+	glm::mat3 cof(glm::cross(m[1], m[2]), glm::cross(m[2], m[0]), glm::cross(m[0], m[1]));
+	return (glm::dot(m[0], cof[0]) < 0.0f) ? -cof : cof;   // keep the orientation of a mirrored model
+}
 
-	// lamp
-	lampShader->use();
-	lampShader->setMat4("view", view);
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, lightPos);
-	model = glm::scale(model, lightSize);
-	lampShader->setMat4("model", model);
-	lamp->draw(lampShader);
-
-	glfwSwapBuffers(mainWindow);
+void render() {
+	{
+		PROFILE_GPU_ZONE("render");
+
+		// newest arcball state published by the input thread
+		const CameraState &camera = cameraInput->latest();
+		drawnCameraVersion = camera.version;
+		frameDirty = false;
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		view = view * camera.camRotation;
+
+		// cone object
+		globalShader->use();
+		globalShader->setMat4("view", view);
+		model = glm::mat4(1.0f);
+		model = model * camera.modelRotation;
+		globalShader->setMat4("model", model);
+		globalShader->setMat3("normalMatrix", computeNormalMatrix(model));
+		cone->draw(globalShader);
+
+		// lamp
+		lampShader->use();
+		lampShader->setMat4("view", view);
+		model = glm::mat4(1.0f);
+		model = glm::translate(model, lightPos);
+		model = glm::scale(model, lightSize);
+		lampShader->setMat4("model", model);
+		lamp->draw(lampShader);
+
+		glfwSwapBuffers(mainWindow);
+	}   // the render zone ends before frameEnd() collects the frame
+	if (Profiler::enabled()) Profiler::frameEnd();
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -177,6 +245,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
+	frameDirty = true;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -184,8 +253,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		glfwSetWindowShouldClose(window, true);
 	}
 	else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-		camArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
-		modelArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
+		cameraInput->reset(SCR_WIDTH, SCR_HEIGHT);
 	}
 	else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
 		arcballCamRot = !arcballCamRot;
@@ -198,21 +266,28 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	}
 	else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
 		cone->updateBuffers(!(cone->smoothShading));
+		frameDirty = true;
 		if (cone->smoothShading) cout << "smooth shading" << endl;
 		else cout << "flat shading" << endl;
 	}
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-	if (arcballCamRot)
-		camArcBall.mouseButtonCallback(window, button, action, mods);
-	else
-		modelArcBall.mouseButtonCallback(window, button, action, mods);
+	// queued for the input thread
+	cameraInput->mouseButton(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, button, action, mods);
 }
 
 void cursor_position_callback(GLFWwindow* window, double x, double y) {
-	if (arcballCamRot)
-		camArcBall.cursorCallback(window, x, y);
-	else
-		modelArcBall.cursorCallback(window, x, y);
+	// queued for the input thread
+	cameraInput->cursor(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, x, y);
+}
+
+// the window was exposed and its contents are lost (e.g. after being covered)
+void window_refresh_callback(GLFWwindow* window) {
+	frameDirty = true;
+}
+
+// true when the last frame drawn is out of date
+bool needsRedraw() {
+	return frameDirty || cameraInput->latest().version != drawnCameraVersion;
 }
@@ -10,11 +10,12 @@ out vec3 Normal;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform mat3 normalMatrix;   // transpose(inverse(mat3(model))), computed once per object on the CPU
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
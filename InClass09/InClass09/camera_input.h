@@ -0,0 +1,294 @@
+#pragma once
+
+// CameraInput
+//
+// Arcball input handled on its own simulation thread instead of inside the GLFW callbacks:
+//
+//   - the callbacks (GLFW thread) only push timestamped events into a lock-free
+//     single-producer/single-consumer ring (SpscQueue), a full ring makes the
+//     producer wait, events are never dropped
+//   - the simulation thread drains the ring and coalesces runs of cursor moves
+//     (only the last position of a run reaches the arcball, the arcball rotation
+//     only depends on the press and the current position); the first move after a
+//     press is applied on its own since it anchors the drag
+//   - the simulation thread makes no GLFW call on the window: the arcballs get the
+//     coordinates of the events and no window
+//   - after each batch it publishes the rotation matrices through a triple buffer,
+//     render() takes the newest complete state without locking or waiting, and
+//     glfwPostEmptyEvent() wakes up a loop that sleeps until something changed
+//
+// The arcballs must not be used directly any more once CameraInput owns them.
+
+#ifndef CAMERA_INPUT_H
+#define CAMERA_INPUT_H
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <arcball.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+struct InputEvent {
+    enum Type { BUTTON, CURSOR, RESET };
+    Type type;
+    double time;          // glfwGetTime() in the callback
+    int target;           // CameraInput::CAMERA or CameraInput::MODEL
+    int button, action, mods;
+    double x, y;          // CURSOR: position, RESET: window size
+    unsigned int id;      // 1, 2, ... in push order
+};
+
+// lock-free ring for one producer thread and one consumer thread (N: power of 2)
+template <typename T, unsigned int N>
+class SpscQueue {
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // producer only, false when full
+    bool push(const T &item) {
+        unsigned int t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == N) return false;
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool empty() {
+        return head.load(memory_order_relaxed) == tail.load(memory_order_acquire);
+    }
+
+    // consumer only, false when empty
+    bool pop(T &item) {
+        unsigned int h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) return false;
+        item = items[h & (N - 1)];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    alignas(64) atomic<unsigned int> head;    // next item to pop, written by the consumer
+    alignas(64) atomic<unsigned int> tail;    // next slot to fill, written by the producer
+};
+
+// one writer thread, one reader thread: the writer fills back() and publish()es,
+// the reader update()s and reads front(); neither ever waits for the other
+template <typename T>
+class TripleBuffer {
+
+public:
+    TripleBuffer() : middle(1) {
+        frontIndex = 0;
+        backIndex = 2;
+    }
+
+    T& back() { return slots[backIndex]; }
+
+    void publish() {
+        backIndex = middle.exchange(backIndex | FRESH) & INDEX;
+    }
+
+    // true when a newer state was published since the last update()
+    bool update() {
+        if (!(middle.load() & FRESH)) return false;
+        frontIndex = middle.exchange(frontIndex) & INDEX;
+        return true;
+    }
+
+    const T& front() { return slots[frontIndex]; }
+
+private:
+    static const unsigned char INDEX = 3;
+    static const unsigned char FRESH = 4;     // middle holds a slot the reader has not seen
+
+    T slots[3];
+    atomic<unsigned char> middle;             // slot index | FRESH
+    unsigned char frontIndex;                 // reader side
+    unsigned char backIndex;                  // writer side
+};
+
+struct CameraState {
+    glm::mat4 camRotation;        // camArcBall.createRotationMatrix()
+    glm::mat4 modelRotation;      // modelArcBall.createRotationMatrix()
+    double inputTime;             // time of the newest event applied (0: none yet)
+    unsigned int lastEvent;       // id of the last event applied (0: none yet)
+    double publishTime;           // glfwGetTime() when this state was published
+    unsigned int version;         // incremented when a rotation changes
+};
+
+class CameraInput {
+
+public:
+    enum Target { CAMERA, MODEL };
+
+    // camArcBall may be NULL (model rotation only); speed: for reset()
+    CameraInput(Arcball* camArcBall, Arcball* modelArcBall, float speed) {
+        arcballs[CAMERA] = camArcBall;
+        arcballs[MODEL] = modelArcBall;
+        this->speed = speed;
+        version = 0;
+        newestTime = 0.0;
+        lastEvent = 0;
+        nextId = 0;
+        dragStart[CAMERA] = dragStart[MODEL] = false;
+        quit = false;
+        publish();
+        states.update();
+        simulation = thread(&CameraInput::run, this);
+    }
+
+    ~CameraInput() {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            quit = true;
+        }
+        wake.notify_one();
+        simulation.join();
+    }
+
+    // GLFW thread, each returns the id of the event (see CameraState::lastEvent)
+    unsigned int mouseButton(Target target, int button, int action, int mods) {
+        InputEvent e = { InputEvent::BUTTON, glfwGetTime(), target, button, action, mods, 0.0, 0.0, 0 };
+        return push(e);
+    }
+
+    unsigned int cursor(Target target, double x, double y) {
+        InputEvent e = { InputEvent::CURSOR, glfwGetTime(), target, 0, 0, 0, x, y, 0 };
+        return push(e);
+    }
+
+    // re-initializes both arcballs
+    unsigned int reset(int width, int height) {
+        InputEvent e = { InputEvent::RESET, glfwGetTime(), CAMERA, 0, 0, 0, (double)width, (double)height, 0 };
+        return push(e);
+    }
+
+    // render thread: newest published state
+    const CameraState& latest() {
+        states.update();
+        return states.front();
+    }
+
+private:
+    static const unsigned int QUEUE_SIZE = 1024;
+
+    Arcball* arcballs[2];
+    float speed;
+
+    SpscQueue<InputEvent, QUEUE_SIZE> events;
+    TripleBuffer<CameraState> states;
+    unsigned int version;         // simulation thread
+    double newestTime;            // simulation thread
+    unsigned int lastEvent;       // simulation thread
+    bool dragStart[2];            // simulation thread: the next move of the arcball follows a press
+    unsigned int nextId;          // GLFW thread
+    CameraState published;        // simulation thread, copy of the last state published
+
+    thread simulation;
+    mutex wakeMutex;
+    condition_variable wake;      // only to sleep while the queue is empty, notified under wakeMutex
+    bool quit;
+
+    unsigned int push(InputEvent e) {
+        e.id = ++nextId;
+        while (!events.push(e)) {
+            notify();
+            this_thread::yield();
+        }
+        notify();
+        return e.id;
+    }
+
+    // under the lock: the simulation thread is either before its predicate check or waiting
+    void notify() {
+        lock_guard<mutex> lock(wakeMutex);
+        wake.notify_one();
+    }
+
+    void apply(const InputEvent &e) {
+        if (e.type == InputEvent::RESET) {
+            for (int i = 0; i < 2; i++) {
+                if (arcballs[i]) arcballs[i]->init((int)e.x, (int)e.y, speed, true, true);
+            }
+        }
+        else if (arcballs[e.target]) {
+            // no window: GLFW window calls belong to the main thread, the arcball only needs the event
+            if (e.type == InputEvent::BUTTON) {
+                arcballs[e.target]->mouseButtonCallback(NULL, e.button, e.action, e.mods);
+                dragStart[e.target] = e.action == GLFW_PRESS;
+            }
+            else {
+                arcballs[e.target]->cursorCallback(NULL, e.x, e.y);
+                dragStart[e.target] = false;
+            }
+        }
+        if (e.time > newestTime) newestTime = e.time;
+        lastEvent = e.id;
+    }
+
+    // false when the rotations did not change (e.g. the cursor moved without a button pressed):
+    // the state still advances lastEvent but keeps its version
+    bool publish() {
+        glm::mat4 cam = arcballs[CAMERA] ? arcballs[CAMERA]->createRotationMatrix() : glm::mat4(1.0f);
+        glm::mat4 model = arcballs[MODEL] ? arcballs[MODEL]->createRotationMatrix() : glm::mat4(1.0f);
+        bool changed = version == 0 || !(cam == published.camRotation) || !(model == published.modelRotation);
+        published.camRotation = cam;
+        published.modelRotation = model;
+        published.inputTime = newestTime;
+        published.lastEvent = lastEvent;
+        published.publishTime = glfwGetTime();
+        if (changed) published.version = ++version;
+        states.back() = published;
+        states.publish();
+        return changed;
+    }
+
+    void run() {
+        while (true) {
+            InputEvent e, lastCursor;
+            bool any = false;
+            bool hasCursor = false;
+            while (events.pop(e)) {
+                any = true;
+                if (e.type == InputEvent::CURSOR) {
+                    // a move of another arcball ends the run
+                    if (hasCursor && lastCursor.target != e.target) {
+                        apply(lastCursor);
+                        hasCursor = false;
+                    }
+                    // the move right after a press sets the start of the drag
+                    if (dragStart[e.target]) {
+                        apply(e);
+                        continue;
+                    }
+                    lastCursor = e;
+                    hasCursor = true;
+                    continue;
+                }
+                if (hasCursor) apply(lastCursor);
+                hasCursor = false;
+                apply(e);
+            }
+            if (hasCursor) apply(lastCursor);
+            if (any) {
+                // wakes up a render loop waiting in glfwWaitEvents*()
+                if (publish()) glfwPostEmptyEvent();
+                continue;
+            }
+
+            unique_lock<mutex> lock(wakeMutex);
+            wake.wait(lock, [this]() { return quit || !events.empty(); });
+            if (quit) return;
+        }
+    }
+};
+
+
+#endif
@@ -1,5 +1,21 @@
 #pragma once
 
+// Cone
+//
+// Procedural mode (vertex pulling): no vertex attributes are stored at all.
+//   procedural_cone.vs rebuilds position and normal from gl_VertexID,
+//   the only buffer holds per-instance parameters
+//   (0: offset (vec3), 1: size (vec2: radius, height)), one instance per addInstance().
+//
+// Mesh cache: the non-procedural mesh of each shading type is generated once and
+//   saved to cone_<flat|smooth>_<radius>.mesh (mesh_file.h), later runs map that
+//   file and upload it with a single glBufferData() (positions|normals|colors).
+//
+// Attribute stripping: streams (bit i: attribute location i, see shader_interface.h)
+//   selects the attributes that are generated, uploaded and enabled in the VAO;
+//   pass activeAttributeMask() of the shader that draws the cone.
+//
+// The VAO and buffers are owned (gpu_resource.h): deleting the cone frees them.
 
 #ifndef CONE_H
 #define CONE_H
@@ -9,7 +25,13 @@
 
 #include <cmath>
 #include <iostream>
+#include <string>
+#include <cstdio>
 #include "shader.h"
+#include "mesh_file.h"
+#include "shader_interface.h"
+#include "profiler.h"
+#include "gpu_resource.h"
 
 using namespace std;
 
@@ -24,28 +46,108 @@ public:
 	int numVertices;
 	float radius;
 	bool smoothShading;
+	bool procedural;     // vertex pulling mode
+	unsigned int streams;     // attribute locations built for (0: position, 1: normal, 2: color)
 
-	Cone() {
+	Cone(bool procedural = false, unsigned int streams = ALL_ATTRIBUTES) {
 		radius = 1.0f;
 		smoothShading = false;
-		createBuffers();
-		updateBuffers();
+		this->procedural = procedural;
+		this->streams = streams | 1;   // position is always needed
+		computeApexNormal();
+		if (procedural) {
+			createInstanceBuffer();
+			addInstance(0.0f, 0.0f, 0.0f, radius, 2.0f);
+		}
+		else {
+			VAO.create("Cone");
+			loadOrGenerate();
+		}
 	}
 
 	void draw(Shader* shader) {
+		PROFILE_GPU_ZONE("Cone::draw");
 		shader->use();
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, 32*3);
+		glBindVertexArray(VAO.id());
+		if (procedural) {
+			shader->setInt("numTriangles", NUMOFTRIANGLE);
+			shader->setBool("smoothShading", smoothShading);
+			shader->setVec3("apexNormal", apexNormal[0], apexNormal[1], apexNormal[2]);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, NUMOFTRIANGLE * 3, numInstances);
+		}
+		else {
+			glDrawArrays(GL_TRIANGLES, 0, 32*3);
+		}
 		glBindVertexArray(0);
 	};
 
 	void updateBuffers(bool smoothShading) {
+		PROFILE_ZONE("Cone::updateBuffers");
 		this->smoothShading = smoothShading;
 		cout << "shading type update" << endl;
-		updateBuffers();
+		if (!procedural) loadOrGenerate();   // procedural: only a uniform changes
+	}
+
+	// procedural mode: one more copy drawn by the same call
+	void addInstance(float x, float y, float z, float radius, float height) {
+		if (!procedural || numInstances >= MAX_INSTANCES) return;
+		float* p = &instances[numInstances * 5];
+		p[0] = x; p[1] = y; p[2] = z;
+		p[3] = radius; p[4] = height;
+		numInstances++;
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+		glBufferSubData(GL_ARRAY_BUFFER, 0, numInstances * 5 * sizeof(float), instances);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// cache file of the current shading type
+	string meshPath() {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "cone_%s_%g_%x.mesh", smoothShading ? "smooth" : "flat", radius, streams & 0x7);
+		return string(buf);
+	}
+
+	// writes the generated streams (valid after updateBuffers()) as one block per attribute
+	bool saveMesh(const char* path) {
+		const int n = NUMOFTRIANGLE * 3;
+		const GLfloat* data[3] = { vertices, normalVectors, colors };
+		vector<float> block;
+		MeshDesc mesh;
+		for (unsigned int loc = 0; loc < 3; loc++) {
+			if (!hasStream(loc)) continue;
+			MeshAttribute a = { loc, 4, (unsigned int)(block.size() * sizeof(float)), 4 * sizeof(float) };
+			mesh.attributes.push_back(a);
+			block.insert(block.end(), data[loc], data[loc] + n * 4);
+		}
+		mesh.vertexData = block.data();
+		mesh.vertexBytes = (unsigned int)(block.size() * sizeof(float));
+		mesh.numVertices = n;
+		mesh.boundsMin[0] = -radius; mesh.boundsMin[1] = -1.0f; mesh.boundsMin[2] = -radius;
+		mesh.boundsMax[0] = radius;  mesh.boundsMax[1] = 1.0f;  mesh.boundsMax[2] = radius;
+		mesh.generator = GENERATOR_VERSION;
+		return MeshFile::save(path, mesh);
+	}
+
+	// maps a cache file into VBO[0], false if it is missing, stale or doesn't match
+	bool loadMesh(const char* path) {
+		MeshFile mesh(path);
+		if (!mesh.isOpen() || mesh.generator() != GENERATOR_VERSION || mesh.numVertices() != NUMOFTRIANGLE * 3) return false;
+		// all streams are blocks of VBO[0]: the per-stream buffers of a generated mesh go
+		if (!VBO[0].id()) VBO[0].create("Cone");
+		VBO[1].reset();
+		VBO[2].reset();
+		mesh.upload(VAO.id(), VBO[0].id());
+		VBO[0].setSize(mesh.vertexBytes());
+		return true;
 	}
 
+	bool hasStream(unsigned int location) { return (streams >> location) & 1; }
+
 private:
+	// bump whenever updateBuffers() generates different data: older cache files are regenerated
+	static const unsigned int GENERATOR_VERSION = 1;
+
 	GLfloat vertices[396];  // 33 * 1 * 4 * 3
 
 	GLfloat normalVectors[396];
@@ -57,43 +159,95 @@ private:
 		1.0f, 0.5f, 0.31f, 1.0f
 	};
 
-	unsigned int VAO;
-	unsigned int VBO[3];      // VBO[0]: for position, VBO[1]: for normal, VBO[2]: for color
+	GpuVertexArray VAO;
+	GpuBuffer VBO[3];      // VBO[0]: for position, VBO[1]: for normal, VBO[2]: for color
 
-	void createBuffers() {
+	// averaged normal at the apex (smooth shading)
+	GLfloat apexNormal[3];
 
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(3, VBO);
+	// procedural mode: per-instance (x, y, z, radius, height)
+	static const int MAX_INSTANCES = 256;
+	GLfloat instances[MAX_INSTANCES * 5];
+	int numInstances = 0;
 
-		glBindVertexArray(VAO);
+	void loadOrGenerate() {
+		string path = meshPath();
+		if (!loadMesh(path.c_str())) {
+			createBuffers();
+			updateBuffers();
+			saveMesh(path.c_str());
+		}
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), 0, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	void computeApexNormal() {
+		apexNormal[0] = apexNormal[1] = apexNormal[2] = 0.0f;
+		for (int i = 0; i <= NUMOFTRIANGLE; i++) {
+			apexNormal[0] += 2.0f * (sin(calAngle(i + 1)) - sin(calAngle(i)));
+			apexNormal[1] += -1.0f * (cos(calAngle(i + 1)) * sin(calAngle(i)) - cos(calAngle(i)) * sin(calAngle(i + 1)));
+			apexNormal[2] += 2.0f * (-1.0f * cos(calAngle(i + 1)) + cos(calAngle(i)));
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(normalVectors), 0, GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for (int i = 0; i < 3; i++) {
+			apexNormal[i] = apexNormal[i] / (NUMOFTRIANGLE + 1);
+		}
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(colors), 0, GL_STATIC_DRAW);
+	void createInstanceBuffer() {
+
+		VAO.create("Cone");
+		VBO[0].create("Cone");
+
+		glBindVertexArray(VAO.id());
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(instances), 0, GL_DYNAMIC_DRAW);
+		VBO[0].setSize(sizeof(instances));
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribDivisor(0, 1);
+		glVertexAttribDivisor(1, 1);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		glBindVertexArray(0);
-
 	}
 
-	void updateBuffers() {
-		GLfloat temp[3] = {0.0f, 0.0f, 0.0f};
-		for (int i = 0; i <= NUMOFTRIANGLE; i++) {
-			temp[0] += 2.0f * (sin(calAngle(i + 1)) - sin(calAngle(i)));
-			temp[1] += -1.0f * (cos(calAngle(i + 1)) * sin(calAngle(i)) - cos(calAngle(i)) * sin(calAngle(i + 1)));
-			temp[2] += 2.0f * (-1.0f * cos(calAngle(i + 1)) + cos(calAngle(i)));
+	// generate path only: a buffer per stream that is built
+	void createBuffers() {
+		for (unsigned int loc = 0; loc < 3; loc++) {
+			if (hasStream(loc)) VBO[loc].create("Cone");
 		}
 
-		for (int i = 0; i < 3; i++) {
-			temp[i] = temp[i] / (NUMOFTRIANGLE + 1);
+		glBindVertexArray(VAO.id());
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), 0, GL_STATIC_DRAW);
+		VBO[0].setSize(sizeof(vertices));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (hasStream(1)) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO[1].id());
+			glBufferData(GL_ARRAY_BUFFER, sizeof(normalVectors), 0, GL_STATIC_DRAW);
+			VBO[1].setSize(sizeof(normalVectors));
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
+
+		if (hasStream(2)) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO[2].id());
+			glBufferData(GL_ARRAY_BUFFER, sizeof(colors), 0, GL_STATIC_DRAW);
+			VBO[2].setSize(sizeof(colors));
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		glBindVertexArray(0);
+
+	}
+
+	void updateBuffers() {
+		GLfloat* temp = apexNormal;
+		// only the streams the shader reads
+		bool hasNormal = hasStream(1), hasColor = hasStream(2);
 		
 		for (int i = 0; i < NUMOFTRIANGLE; i++) {
 			vertices[12 * i + 0] = 0.0f;
@@ -112,12 +266,14 @@ private:
 			vertices[12 * i + 11] = 1.0f;
 			
 
-			for (int p = 0; p < 4; p++) {
+			for (int p = 0; hasColor && p < 4; p++) {
 				colors[12 * i + 4 * p + 0] = mainColors[0];
 				colors[12 * i + 4 * p + 1] = mainColors[1];
 				colors[12 * i + 4 * p + 2] = mainColors[2];
 				colors[12 * i + 4 * p + 3] = mainColors[3];
 			}
+
+			if (!hasNormal) continue;
 			
 			GLfloat x = 2.0f * (sin(calAngle(i + 1)) - sin(calAngle(i)));
 			GLfloat y = -1.0f * (cos(calAngle(i + 1)) * sin(calAngle(i)) - cos(calAngle(i)) * sin(calAngle(i + 1)));
@@ -158,25 +314,29 @@ private:
 			}
 		}
 
-		glBindVertexArray(VAO);
+		glBindVertexArray(VAO.id());
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
 		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
 		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
 		glEnableVertexAttribArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(normalVectors), normalVectors);
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (hasNormal) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO[1].id());
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(normalVectors), normalVectors);
+			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+			glEnableVertexAttribArray(1);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(colors), colors);
-		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (hasColor) {
+			glBindBuffer(GL_ARRAY_BUFFER, VBO[2].id());
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(colors), colors);
+			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+			glEnableVertexAttribArray(2);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
 
 		glBindVertexArray(0);
 	};
@@ -0,0 +1,110 @@
+#pragma once
+
+// MappedFile
+//
+// Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap elsewhere).
+// The data stays valid until close() or the destructor.
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <cstddef>
+
+class MappedFile {
+
+public:
+    MappedFile() {
+        base = NULL;
+        length = 0;
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return base; }
+    size_t size() const { return length; }
+    bool isOpen() const { return base != NULL; }
+
+#ifdef _WIN32
+    bool open(const char* path) {
+        close();
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) base = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!base) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        base = NULL;
+        length = 0;
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);   // the mapping keeps the file alive
+        if (p == MAP_FAILED) return false;
+        base = (const unsigned char*)p;
+        length = (size_t)st.st_size;
+        return true;
+    }
+
+    void close() {
+        if (base) munmap((void*)base, length);
+        base = NULL;
+        length = 0;
+    }
+#endif
+
+private:
+    const unsigned char* base;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+
+#endif
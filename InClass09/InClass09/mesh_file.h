@@ -0,0 +1,255 @@
+#pragma once
+
+// MeshFile
+//
+// Versioned binary mesh format that is loaded without any parsing:
+// the file is memory-mapped and the vertex/index blocks go straight to glBufferData().
+//
+//   header | attributes | LODs | vertex data | index data (uint32)
+//
+//   - attributes: (location, # of float components, offset, stride) into the
+//     vertex data, so both interleaved and one-block-per-attribute layouts work
+//   - LODs: ranges of the index data (of the vertices when there are no indices),
+//     LOD 0 is the full mesh
+//   - bounds: axis-aligned box of the positions
+//   - generator: version of the code that produced the data, a cache whose
+//     generator changed since it was written is stale (generator())
+//   - blocks are aligned to 16 bytes
+//
+// save() writes a MeshDesc (e.g. from Cone::saveMesh()), MeshFile(path) maps a
+// file and upload() fills the VAO/VBO/EBO the caller created.
+
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include "mapped_file.h"
+
+using namespace std;
+
+struct MeshAttribute {
+    unsigned int location;       // vertex shader attribute location
+    unsigned int components;     // # of floats
+    unsigned int offset;         // in bytes, from the beginning of the vertex data
+    unsigned int stride;         // in bytes
+};
+
+struct MeshLOD {
+    unsigned int first;          // first index (or vertex)
+    unsigned int count;          // # of indices (or vertices)
+};
+
+struct MeshDesc {
+    vector<MeshAttribute> attributes;
+    const void* vertexData;
+    unsigned int vertexBytes;
+    unsigned int numVertices;
+    vector<unsigned int> indices;     // empty: drawn with glDrawArrays()
+    vector<MeshLOD> lods;             // empty: one LOD with the whole mesh
+    float boundsMin[3];
+    float boundsMax[3];
+    unsigned int generator;           // version of the generating code (0: not generated)
+};
+
+class MeshFile {
+
+public:
+    MeshFile(const char* path) {
+        header = NULL;
+        if (!file.open(path)) return;
+
+        const Header* h = (const Header*)file.data();
+        if (file.size() < sizeof(Header) || memcmp(h->magic, "MESH", 4) != 0 || h->version != MESH_VERSION
+            || !valid(h)) {
+            cout << "ERROR::MESH_FILE::INVALID_FILE: " << path << endl;
+            file.close();
+            return;
+        }
+        header = h;
+    }
+
+    bool isOpen() { return header != NULL; }
+
+    unsigned int numVertices() { return header->numVertices; }
+    unsigned int numIndices() { return header->numIndices; }
+    unsigned int vertexBytes() { return header->vertexBytes; }
+    unsigned int numLODs() { return header->numLODs; }
+    unsigned int generator() { return header->generator; }
+    MeshLOD lod(unsigned int i) { return lods()[i]; }
+    const float* boundsMin() { return header->boundsMin; }
+    const float* boundsMax() { return header->boundsMax; }
+
+    // copies the mapped blocks into the buffers and sets the attribute pointers of VAO
+    void upload(unsigned int VAO, unsigned int VBO, unsigned int EBO = 0) {
+        upload(VAO, VBO, EBO, (const MeshAttribute*)(file.data() + sizeof(Header)), header->numAttributes,
+            file.data() + header->vertexOffset, header->vertexBytes,
+            (const unsigned int*)(file.data() + header->indexOffset), header->numIndices);
+    }
+
+    // same, into an existing buffer at byte offset (a BufferPool range); vertices only
+    void uploadTo(unsigned int VAO, unsigned int buffer, unsigned int offset) {
+        const MeshAttribute* attributes = (const MeshAttribute*)(file.data() + sizeof(Header));
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, header->vertexBytes, file.data() + header->vertexOffset);
+        for (unsigned int i = 0; i < header->numAttributes; i++) {
+            const MeshAttribute &a = attributes[i];
+            glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, a.stride, (void*)(size_t)(offset + a.offset));
+            glEnableVertexAttribArray(a.location);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // same for a mesh that is still in memory (generated or imported)
+    static void upload(unsigned int VAO, unsigned int VBO, unsigned int EBO, const MeshDesc &mesh) {
+        upload(VAO, VBO, EBO, mesh.attributes.data(), (unsigned int)mesh.attributes.size(),
+            mesh.vertexData, mesh.vertexBytes, mesh.indices.data(), (unsigned int)mesh.indices.size());
+    }
+
+    static void upload(unsigned int VAO, unsigned int VBO, unsigned int EBO,
+                       const MeshAttribute* attributes, unsigned int numAttributes,
+                       const void* vertexData, unsigned int vertexBytes,
+                       const unsigned int* indices, unsigned int numIndices) {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+        for (unsigned int i = 0; i < numAttributes; i++) {
+            const MeshAttribute &a = attributes[i];
+            glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, a.stride, (void*)(size_t)a.offset);
+            glEnableVertexAttribArray(a.location);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // the element buffer binding is part of the VAO state
+        if (EBO && numIndices > 0) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+        }
+        glBindVertexArray(0);
+    }
+
+    static bool save(const char* path, const MeshDesc &mesh) {
+        vector<MeshLOD> lods = mesh.lods;
+        if (lods.empty()) {
+            MeshLOD all = { 0, mesh.indices.empty() ? mesh.numVertices : (unsigned int)mesh.indices.size() };
+            lods.push_back(all);
+        }
+
+        Header h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, "MESH", 4);
+        h.version = MESH_VERSION;
+        h.numVertices = mesh.numVertices;
+        h.numIndices = (unsigned int)mesh.indices.size();
+        h.numAttributes = (unsigned int)mesh.attributes.size();
+        h.numLODs = (unsigned int)lods.size();
+        h.vertexOffset = align(sizeof(Header) + h.numAttributes * sizeof(MeshAttribute) + h.numLODs * sizeof(MeshLOD));
+        h.vertexBytes = mesh.vertexBytes;
+        h.indexOffset = align(h.vertexOffset + h.vertexBytes);
+        memcpy(h.boundsMin, mesh.boundsMin, sizeof(h.boundsMin));
+        memcpy(h.boundsMax, mesh.boundsMax, sizeof(h.boundsMax));
+        h.generator = mesh.generator;
+
+        ofstream out(path, ios::binary | ios::trunc);
+        if (!out) {
+            cout << "ERROR::MESH_FILE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << endl;
+            return false;
+        }
+        const char zeros[ALIGNMENT] = { 0 };
+        out.write((const char*)&h, sizeof(h));
+        out.write((const char*)mesh.attributes.data(), h.numAttributes * sizeof(MeshAttribute));
+        out.write((const char*)lods.data(), h.numLODs * sizeof(MeshLOD));
+        out.write(zeros, h.vertexOffset - (unsigned int)out.tellp());
+        out.write((const char*)mesh.vertexData, h.vertexBytes);
+        out.write(zeros, h.indexOffset - (unsigned int)out.tellp());
+        out.write((const char*)mesh.indices.data(), h.numIndices * sizeof(unsigned int));
+        return (bool)out;
+    }
+
+    // axis-aligned bounds of n positions (3 floats each, tightly packed)
+    static void computeBounds(const float* positions, unsigned int n, float boundsMin[3], float boundsMax[3]) {
+        for (int c = 0; c < 3; c++) {
+            boundsMin[c] = n > 0 ? positions[c] : 0.0f;
+            boundsMax[c] = boundsMin[c];
+        }
+        for (unsigned int i = 1; i < n; i++) {
+            for (int c = 0; c < 3; c++) {
+                float v = positions[i * 3 + c];
+                if (v < boundsMin[c]) boundsMin[c] = v;
+                if (v > boundsMax[c]) boundsMax[c] = v;
+            }
+        }
+    }
+
+private:
+    struct Header {
+        char magic[4];               // "MESH"
+        unsigned int version;
+        unsigned int numVertices;
+        unsigned int numIndices;
+        unsigned int numAttributes;
+        unsigned int numLODs;
+        unsigned int vertexOffset;   // in bytes, from the beginning of the file
+        unsigned int vertexBytes;
+        unsigned int indexOffset;
+        float boundsMin[3];
+        float boundsMax[3];
+        unsigned int generator;
+    };
+
+    static const unsigned int MESH_VERSION = 1;
+    static const unsigned int ALIGNMENT = 16;
+
+    MappedFile file;
+    const Header* header;            // NULL when the file could not be opened
+
+    // every block inside the file, every attribute inside the vertex data and every LOD
+    // inside the indices (vertices): upload() and lod() never read past the mapping.
+    // Subtract-then-compare only, a sum could wrap in a 32-bit size_t (Win32).
+    bool valid(const Header* h) {
+        size_t size = file.size();
+        if (h->vertexOffset < sizeof(Header) || h->vertexOffset > size || h->vertexBytes > size - h->vertexOffset
+            || h->indexOffset > size || h->numIndices > (size - h->indexOffset) / sizeof(unsigned int))
+            return false;
+        size_t tables = h->vertexOffset - sizeof(Header);
+        if (h->numAttributes > tables / sizeof(MeshAttribute)) return false;
+        tables -= h->numAttributes * sizeof(MeshAttribute);
+        if (h->numLODs > tables / sizeof(MeshLOD)) return false;
+
+        const MeshAttribute* attributes = (const MeshAttribute*)(file.data() + sizeof(Header));
+        for (unsigned int i = 0; i < h->numAttributes; i++) {
+            // offset is relative to the whole vertex data: interleaved (offset < stride) and
+            // one block per attribute (offset = start of the block) are both valid
+            const MeshAttribute &a = attributes[i];
+            if (a.components < 1 || a.components > 4) return false;
+            unsigned int bytes = a.components * sizeof(float);
+            unsigned int stride = a.stride ? a.stride : bytes;    // 0: tightly packed
+            if (stride < bytes || a.offset >= h->vertexBytes || bytes > h->vertexBytes - a.offset) return false;
+            // the last vertex of the attribute inside the vertex data
+            if (h->numVertices > 0 && h->numVertices - 1 > (h->vertexBytes - a.offset - bytes) / stride) return false;
+        }
+
+        const MeshLOD* l = (const MeshLOD*)(file.data() + sizeof(Header) + h->numAttributes * sizeof(MeshAttribute));
+        unsigned int numElements = h->numIndices ? h->numIndices : h->numVertices;
+        for (unsigned int i = 0; i < h->numLODs; i++) {
+            if (l[i].first > numElements || l[i].count > numElements - l[i].first) return false;
+        }
+        return true;
+    }
+
+    const MeshLOD* lods() {
+        return (const MeshLOD*)(file.data() + sizeof(Header) + header->numAttributes * sizeof(MeshAttribute));
+    }
+
+    static unsigned int align(size_t offset) {
+        return (unsigned int)((offset + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1));
+    }
+};
+
+
+#endif
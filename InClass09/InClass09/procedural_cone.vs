@@ -0,0 +1,48 @@
+#version 330 core
+// Cone generated from gl_VertexID (see Cone procedural mode in cone.h)
+layout (location = 0) in vec3 aOffset;   // per instance
+layout (location = 1) in vec2 aSize;     // per instance: radius, height
+
+out vec3 FragPos;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat3 normalMatrix;
+uniform int numTriangles;
+uniform bool smoothShading;
+uniform vec3 apexNormal;
+
+const float PI = 3.14159265358979;
+
+void main()
+{
+    // triangle i: apex, base vertex i, base vertex i + 1
+    int i = gl_VertexID / 3;
+    int corner = gl_VertexID % 3;
+    float a0 = (2.0 * PI * float(i)) / float(numTriangles);
+    float a1 = (2.0 * PI * float(i + 1)) / float(numTriangles);
+    float angle = (corner == 2) ? a1 : a0;
+
+    float radius = aSize.x;
+    float halfHeight = aSize.y / 2.0;
+    vec3 pos = (corner == 0) ? vec3(0.0, halfHeight, 0.0)
+                             : vec3(radius * cos(angle), -halfHeight, radius * sin(angle));
+
+    vec3 norm;
+    if (!smoothShading) {
+        // face normal (same as the buffer version for radius 1, height 2)
+        norm = vec3(aSize.y * (sin(a1) - sin(a0)),
+                    radius * (cos(a0) * sin(a1) - cos(a1) * sin(a0)),
+                    aSize.y * (cos(a0) - cos(a1)));
+    }
+    else {
+        norm = (corner == 0) ? apexNormal : vec3(cos(angle), 0.0, sin(angle));
+    }
+
+    FragPos = vec3(model * vec4(pos + aOffset, 1.0));
+    Normal = normalMatrix * norm;
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -1,7 +1,12 @@
 #version 330 core
 out vec4 FragColor;
 
-uniform vec4 color;
+layout (std140) uniform Object {   // ObjectBlock (InClass10.cpp), one per draw
+    mat4 model;
+    mat3 normalMatrix;   // transpose(inverse(mat3(model))), computed once per object on the CPU
+    vec4 color;          // lamps
+    int numSubdiv;       // procedural cylinder
+};
 
 void main()
 {
@@ -1,8 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
+layout (std140) uniform Object {   // ObjectBlock (InClass10.cpp), one per draw
+    mat4 model;
+    mat3 normalMatrix;   // transpose(inverse(mat3(model))), computed once per object on the CPU
+    vec4 color;          // lamps
+    int numSubdiv;       // procedural cylinder
+};
+layout (std140) uniform Camera {   // CameraUBO
+    mat4 view;
+};
 uniform mat4 projection;
 
 void main()
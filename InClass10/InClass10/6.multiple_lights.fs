@@ -43,18 +43,40 @@ struct SpotLight {
     vec3 specular;
 };
 
+// permutation defines (injected after #version by ShaderPermutations, defaults = all lights)
+#ifndef NR_DIR_LIGHTS
+#define NR_DIR_LIGHTS 1
+#endif
+#ifndef NR_POINT_LIGHTS
 #define NR_POINT_LIGHTS 2
+#endif
+#ifndef NR_SPOT_LIGHTS
+#define NR_SPOT_LIGHTS 1      // 0 or 1
+#endif
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 1
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
 uniform vec3 viewPos;
+#if NR_DIR_LIGHTS > 0
 uniform DirLight dirLight;
+#endif
+#if NR_POINT_LIGHTS > 0
 uniform PointLight pointLights[NR_POINT_LIGHTS];
+#endif
+#if NR_SPOT_LIGHTS > 0
 uniform SpotLight spotLight;
+#endif
 uniform Material material;
 
+// material colors, fetched once per fragment
+vec3 diffuseColor;
+vec3 specularColor;
+
 // function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -65,15 +87,26 @@ void main()
     // properties
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
+    diffuseColor = texture(material.diffuse, TexCoords).rgb;
+#if HAS_SPECULAR_MAP
+    specularColor = texture(material.specular, TexCoords).rgb;
+#endif
+    vec3 result = vec3(0.0);
     
     // directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+#if NR_DIR_LIGHTS > 0
+    result += CalcDirLight(dirLight, norm, viewDir);
+#endif
 
     // point lights
+#if NR_POINT_LIGHTS > 0
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
         result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+#endif
 
+#if NR_SPOT_LIGHTS > 0
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+#endif
     
     FragColor = vec4(result, 1.0);
 }
@@ -84,13 +117,17 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
+    // combine results
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+#if HAS_SPECULAR_MAP
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 specular = light.specular * spec * specularColor;
+#else
+    vec3 specular = vec3(0.0);
+#endif
     return (ambient + diffuse + specular);
 }
 
@@ -100,16 +137,20 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+#if HAS_SPECULAR_MAP
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = light.specular * spec * specularColor;
+#else
+    vec3 specular = vec3(0.0);
+#endif
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -120,17 +161,21 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = light.ambient * diffuseColor;
     
     // diffuse 
     vec3 lightDir = normalize(light.position - fragPos);
     float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;  
+    vec3 diffuse = light.diffuse * diff * diffuseColor;  
     
     // specular
+#if HAS_SPECULAR_MAP
     vec3 reflectDir = reflect(-lightDir, normal);  
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;  
+    vec3 specular = light.specular * spec * specularColor;  
+#else
+    vec3 specular = vec3(0.0);
+#endif
     
     // spotlight (soft edges)
     float theta = dot(lightDir, normalize(-light.direction)); 
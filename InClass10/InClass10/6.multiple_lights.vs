@@ -8,14 +8,21 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
+layout (std140) uniform Object {   // ObjectBlock (InClass10.cpp), one per draw
+    mat4 model;
+    mat3 normalMatrix;   // transpose(inverse(mat3(model))), computed once per object on the CPU
+    vec4 color;          // lamps
+    int numSubdiv;       // procedural cylinder
+};
+layout (std140) uniform Camera {   // CameraUBO
+    mat4 view;
+};
 uniform mat4 projection;
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    Normal = normalMatrix * aNormal;  
     TexCoords = aTexCoords;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
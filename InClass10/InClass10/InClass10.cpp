@@ -1,6 +1,7 @@
 #define _USE_MATH_DEFINES
 
 #include <GL/glew.h> 
+#include "gl_stats.h"       // first: the headers below make GL calls too
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,8 +11,22 @@
 
 #include "cylinder.h"
 #include <shader.h>
+#include "shader_cache.h"
+#include "shader_permutation.h"
+#include "shader_manager.h"
+#include "asset_pack.h"
+#include "mesh_importer.h"
+#include "camera_ubo.h"
+#include "stream_buffer.h"
+#include "frame_pipeline.h"
+#include "latency_monitor.h"
+#include "profiler.h"
+#include "gpu_resource.h"
+#include "buffer_pool.h"
 #include <cube.h>
 #include <arcball.h>
+#include "camera_input.h"
+#include "frame_arena.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -23,16 +38,31 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double x, double y);
-unsigned int loadTexture(const char*);
+void window_refresh_callback(GLFWwindow* window);
+bool needsRedraw();
+GpuTexture loadTexture(const char*);
+void setupLightingShader();
+glm::mat3 computeNormalMatrix(const glm::mat4& model);
+bool writeObject(const glm::mat4& model, const glm::mat3& normalMatrix, const glm::vec4& color, StreamRange& range,
+                 int numSubdiv = 0);
+void bindObject(const StreamRange& range);
 void render();
+struct FrameData;
+void prepareFrame(FrameData& frame);
+void submitFrame(const FrameData& frame);
 
 // Global variables
 GLFWwindow* mainWindow = NULL;
-Shader* lightingShader = NULL;
+AssetPack* assets = NULL;
+ShaderManager* shaderManager = NULL;
+ShaderPermutations* lightingPermutations = NULL;
+CachedShader* lightingShader = NULL;
+bool lightingReady = false;   // lighting shader linked and its uniforms set
 Shader* lampShader = NULL;
 unsigned int SCR_WIDTH = 600;
 unsigned int SCR_HEIGHT = 600;
 Cylinder* cylinder;
+ImportedMesh* importedMesh = NULL;   // "InClass10 <file.obj|.gltf|.glb>": drawn instead of the cylinder
 Cube* lamp;
 glm::mat4 projection, view, model;
 
@@ -41,6 +71,71 @@ float arcballSpeed = 0.2f;
 static Arcball camArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 static Arcball modelArcBall(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
 bool arcballCamRot = true;
+CameraInput *cameraInput = NULL;    // owns the arcballs after glAllInit()
+
+// render on demand: a frame is drawn only when the camera, the window or the scene changed,
+// otherwise the loop sleeps in glfwWaitEventsTimeout()
+bool renderOnDemand = true;
+bool frameDirty = true;                  // set by resize, keys, ...; cleared by render()
+unsigned int drawnCameraVersion = 0;     // CameraState::version of the last frame drawn
+const double IDLE_TIMEOUT = 1.0;         // seconds
+
+// low latency: one frame in flight, the view matrix is read from the input thread after
+// the wait for the previous frame and written into a persistently mapped UBO
+bool lowLatency = false;
+CameraUBO *cameraUBO = NULL;             // view matrix of all shaders (Camera uniform block)
+
+// frames in flight (lowLatency: 1): the CPU prepares a frame while the GPU still renders the
+// ones before it; CPU time and GPU waits per frame printed on exit
+int framesInFlight = 2;
+bool pipelineReport = false;
+FramePipeline *framePipeline = NULL;
+
+// everything that changes per frame (camera, Object blocks) is written ahead into a
+// persistently mapped ring of frame regions, reused only once FramePipeline's fence of the
+// frame that wrote them signaled (no glUniform*/glBufferSubData)
+StreamBuffer *frameStream = NULL;
+
+// Object uniform block of the shaders (std140), one per draw
+struct ObjectBlock {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];   // mat3: a vec4 per column
+    glm::vec4 color;
+    int numSubdiv;               // procedural cylinder
+    int padding[3];              // std140 rounds the block to 16 bytes
+};
+const unsigned int OBJECT_BINDING = 1;   // CameraUBO::BINDING is 0
+
+// what prepareFrame() hands to submitFrame(): the stream ranges of the camera and of every draw
+struct FrameData {
+    StreamRange camera, meshObject, lampObjects[3];
+};
+FrameRing<FrameData> *frameData = NULL;  // one per frame in flight
+
+// input-to-photon latency and frame pacing, reported and written to CSV on exit
+bool measureLatency = false;
+LatencyMonitor *latency = NULL;
+
+// CPU/GPU zones of render(), the draws, buffer updates, texture loading and shader
+// construction, written to trace.json (chrome://tracing) on exit
+bool profile = false;
+
+// GL calls, redundant state sets, uploads and draws per frame, summary on exit
+bool glStats = false;
+
+// live GPU objects by owner, current and peak bytes, printed on exit after the
+// scene is deleted (whatever is still listed leaked)
+bool gpuMemoryReport = false;
+
+// mesh vertex streams are ranges of a few shared buffers (no glGenBuffers per mesh)
+bool pooledMeshes = true;
+BufferPool *meshPool = NULL;
+
+// frame arena peak usage and the frames that still allocated from the heap, printed on exit
+bool frameArenaReport = false;
+
+// vertex pulling: generate the cylinder in the vertex shader from gl_VertexID
+bool proceduralMesh = false;
 
 // for camera
 glm::vec3 cameraPos(0.0f, 0.0f, 9.0f);
@@ -55,26 +150,69 @@ glm::vec3 pointLightPositions[] = {
     glm::vec3(-1.0f, 0.5f, -1.0f)
 };
 
+// active light set: selects the 6.multiple_lights.fs variant
+//   no directional light, 2 point lights, 1 spot light, no specular map
+LightConfig lightConfig = { 0, 2, 1, false };
+
 // positions&direction of the spot light
 glm::vec3 spotLightPosition(1.0f, 1.0f, 1.0f);
 glm::vec3 spotLightDirection(-1.0f, -1.0f, -1.0f);
 
 // for texture
-static unsigned int diffuseMap, specularMap;  // texture ids for diffuse and specular maps
+static GpuTexture diffuseMap, specularMap;  // textures for diffuse and specular maps
+
+// packed into InClass10.pack by "InClass10 --pack" (post-build step)
+// (6.lamp.vs/fs are not: the lamp uses Shader, which always reads loose files)
+const char* packPath = "InClass10.pack";
+vector<string> assetFiles = {
+    "6.multiple_lights.vs", "6.multiple_lights.fs", "procedural_cylinder.vs",
+    "container2.bmp", "container2_specular.bmp"
+};
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && string(argv[1]) == "--pack") {
+        return AssetPack::build(packPath, assetFiles) ? 0 : -1;
+    }
+
+    // one mapping for all shaders and textures (loose files are used if the pack is missing)
+    assets = new AssetPack(packPath);
+    assets->mount();
+
+    // an imported mesh needs the regular vertex shader
+    const char* meshPath = (argc > 1) ? argv[1] : NULL;
+    if (meshPath) proceduralMesh = false;
+
     mainWindow = glAllInit();
+    cameraInput = new CameraInput(&camArcBall, &modelArcBall, arcballSpeed);
+    Profiler::setEnabled(profile);
+    GLStats::setEnabled(glStats);
 
     // shader loading and compile (by calling the constructor)
-    lightingShader = new Shader("6.multiple_lights.vs", "6.multiple_lights.fs");
-    lampShader = new Shader("6.lamp.vs", "6.lamp.fs");
+    // lighting shader: variant specialized for the active lights (program binary cached on disk),
+    // only submitted here: the driver compiles it in the background while the rest starts up
+    shaderManager = new ShaderManager();
+    if (proceduralMesh)
+        lightingPermutations = new ShaderPermutations("procedural_cylinder.vs", "6.multiple_lights.fs", shaderManager);
+    else
+        lightingPermutations = new ShaderPermutations("6.multiple_lights.vs", "6.multiple_lights.fs", shaderManager);
+    lightingShader = lightingPermutations->get(lightConfig);
+    {
+        PROFILE_ZONE("Shader");
+        lampShader = new Shader("6.lamp.vs", "6.lamp.fs");
+    }
+    if (pooledMeshes) meshPool = new BufferPool("meshes");
+    framePipeline = new FramePipeline(lowLatency ? 1 : framesInFlight);
+    frameData = new FrameRing<FrameData>(*framePipeline);
+    frameStream = new StreamBuffer("frame", 64 << 10, framePipeline->framesInFlight());
+    cameraUBO = new CameraUBO(frameStream);
+    cameraUBO->attach(lampShader->ID);
+    bindUniformBlock(lampShader->ID, "Object", OBJECT_BINDING);
+    if (measureLatency) latency = new LatencyMonitor();
 
     // projection and view matrix
-    lightingShader->use();
     projection = glm::perspective(glm::radians(45.0f),
         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    lightingShader->setMat4("projection", projection);
 
     lampShader->use();
     lampShader->setMat4("projection", projection);
@@ -83,60 +221,65 @@ int main()
     diffuseMap = loadTexture("container2.bmp");
     //specularMap = loadTexture("container2_specular.bmp");
 
-    // transfer texture id to fragment shader
-    lightingShader->use();
-    lightingShader->setInt("material.diffuse", 0);
-    lightingShader->setInt("material.specular", 1);
-    lightingShader->setFloat("material.shininess", 32);
-
-    lightingShader->setVec3("viewPos", cameraPos);
-
-    // transfer lighting parameters to fragment shader
-    // directional light
-    /*lightingShader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-    lightingShader->setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader->setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-    lightingShader->setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);*/
-    
-    // point light 1
-    lightingShader->setVec3("pointLights[0].position", pointLightPositions[0]);
-    lightingShader->setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader->setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader->setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader->setFloat("pointLights[0].constant", 1.0f);
-    lightingShader->setFloat("pointLights[0].linear", 0.09);
-    lightingShader->setFloat("pointLights[0].quadratic", 0.032);
-  
-    // point light 2
-    lightingShader->setVec3("pointLights[1].position", pointLightPositions[1]);
-    lightingShader->setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader->setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader->setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader->setFloat("pointLights[1].constant", 1.0f);
-    lightingShader->setFloat("pointLights[1].linear", 0.09);
-    lightingShader->setFloat("pointLights[1].quadratic", 0.032);
-    
-    // spot light
-    lightingShader->setVec3("spotLight.position", spotLightPosition);
-    lightingShader->setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-    lightingShader->setVec3("spotLight.diffuse", 0.9f, 0.3f, 0.6f);
-    lightingShader->setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-    lightingShader->setVec3("spotLight.direction", spotLightDirection);
-    lightingShader->setFloat("spotLight.innercutOff", glm::cos(glm::radians(17.5f)));
-    lightingShader->setFloat("spotLight.outercutOff", glm::cos(glm::radians(35.0f)));
-    lightingShader->setFloat("spotLight.constant", 1.0f);
-    lightingShader->setFloat("spotLight.linear", 0.14);
-    lightingShader->setFloat("spotLight.quadratic", 0.07);
-
-    // create a cubes
-    cylinder = new Cylinder(5, 1, 2);
+    // create a cubes (the cylinder is created once the lighting shader is linked)
     lamp = new Cube();
 
+    // imported mesh (parsed while the lighting shader compiles)
+    if (meshPath) {
+        importedMesh = new ImportedMesh();
+        if (MeshImporter::import(meshPath, *importedMesh)) importedMesh->upload();
+        else {
+            delete importedMesh;
+            importedMesh = NULL;
+        }
+    }
+
     while (!glfwWindowShouldClose(mainWindow)) {
-        render();
-        glfwPollEvents();
+        // the cylinder shows up as soon as its shader is done, the lamps are drawn meanwhile
+        shaderManager->update();
+        if (!lightingReady && lightingShader->ready()) {
+            setupLightingShader();
+            // only the vertex streams the lighting shader reads (no colors for 6.multiple_lights.vs)
+            cylinder = new Cylinder(5, 1, 2, proceduralMesh, activeAttributeMask(lightingShader->ID), meshPool);
+            lightingReady = true;
+            frameDirty = true;
+            FrameArena::warmUp();
+        }
+        if (!renderOnDemand || needsRedraw()) render();
+        // the input thread wakes the loop up with glfwPostEmptyEvent(), pending shaders are polled
+        if (renderOnDemand) glfwWaitEventsTimeout(shaderManager->numPending() > 0 ? 0.01 : IDLE_TIMEOUT);
+        else glfwPollEvents();
     }
 
+    if (latency) {
+        latency->report();
+        latency->writeCSV("latency_events.csv", "latency_frames.csv");
+        delete latency;
+    }
+    if (pipelineReport) framePipeline->report();
+    if (profile) Profiler::writeTrace("trace.json");
+    if (glStats) GLStats::report();
+
+    // GL objects go before the context
+    if (gpuMemoryReport && meshPool) meshPool->report();
+    if (gpuMemoryReport) frameStream->report();
+    delete cylinder;
+    delete importedMesh;
+    delete lamp;
+    delete lightingPermutations;     // owns lightingShader
+    delete lampShader;
+    delete shaderManager;
+    delete cameraUBO;
+    delete frameStream;              // after the last frame that wrote to it
+    delete frameData;
+    delete framePipeline;
+    delete meshPool;                 // after the meshes that hold its ranges
+    diffuseMap.reset();
+    specularMap.reset();
+    if (gpuMemoryReport) GpuMemory::report();
+    if (frameArenaReport) FrameArena::report();
+    delete cameraInput;
+    delete assets;
     glfwTerminate();
     return 0;
 }
@@ -168,6 +311,7 @@ GLFWwindow* glAllInit()
     glfwSetKeyCallback(window, key_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
     // OpenGL states
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -185,14 +329,15 @@ GLFWwindow* glAllInit()
     return window;
 }
 
-unsigned int loadTexture(const char* texFileName) {
-    unsigned int texture;
+GpuTexture loadTexture(const char* texFileName) {
+    PROFILE_ZONE("loadTexture");
+    GpuTexture texture;
 
     // Create texture ids.
-    glGenTextures(1, &texture);
+    texture.create(texFileName);
 
     // All upcomming GL_TEXTURE_2D operations now on "texture" object
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindTexture(GL_TEXTURE_2D, texture.id());
 
     // Set texture parameters for wrapping.
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -205,7 +350,13 @@ unsigned int loadTexture(const char* texFileName) {
 
     int width, height, nrChannels;
     stbi_set_flip_vertically_on_load(true);   // vertical flip the texture
-    unsigned char* image = stbi_load(texFileName, &width, &height, &nrChannels, 0);
+    const unsigned char* data;
+    size_t size;
+    unsigned char* image;
+    if (assets->find(texFileName, data, size))   // decode straight from the mapped pack
+        image = stbi_load_from_memory(data, (int)size, &width, &height, &nrChannels, 0);
+    else
+        image = stbi_load(texFileName, &width, &height, &nrChannels, 0);
     if (!image) {
         printf("texture %s loading error ... \n", texFileName);
     }
@@ -216,60 +367,204 @@ unsigned int loadTexture(const char* texFileName) {
     else if (nrChannels == 3) format = GL_RGB;
     else if (nrChannels == 4) format = GL_RGBA;
 
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindTexture(GL_TEXTURE_2D, texture.id());
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
     glGenerateMipmap(GL_TEXTURE_2D);
+    if (image) {
+        texture.setSize(GpuMemory::textureBytes(width, height, nrChannels, true));
+        stbi_image_free(image);
+    }
 
     return texture;
 }
 
-void render() {
+// normal matrix (transpose of the inverse of the upper 3x3 of model), once per object instead of per vertex
+//   rigid (orthonormal columns: rotation + translation only): the upper 3x3 itself, no inverse at all
+//   otherwise (scaled, sheared): the cofactor matrix, parallel to the inverse transpose
+//   (the shaders normalize the normal)
+glm::mat3 computeNormalMatrix(const glm::mat4& model) {
+    glm::mat3 m(model);
+    const float EPS = 1e-4f;
+    bool rigid = fabs(glm::dot(m[0], m[0]) - 1.0f) < EPS && fabs(glm::dot(m[1], m[1]) - 1.0f) < EPS
+        && fabs(glm::dot(m[2], m[2]) - 1.0f) < EPS && fabs(glm::dot(m[0], m[1])) < EPS
+        && fabs(glm::dot(m[1], m[2])) < EPS && fabs(glm::dot(m[2], m[0])) < EPS;
+    if (rigid) return m;
+    glm::mat3 cof(glm::cross(m[1], m[2]), glm::cross(m[2], m[0]), glm::cross(m[0], m[1]));
+    return (glm::dot(m[0], cof[0]) < 0.0f) ? -cof : cof;   // keep the orientation of a mirrored model
+}
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// writes the Object block of a draw into this frame's region of the stream buffer
+// (range stays empty if the region is full)
+bool writeObject(const glm::mat4& model, const glm::mat3& normalMatrix, const glm::vec4& color, StreamRange& range,
+                 int numSubdiv) {
+    if (!frameStream->allocateUniform(sizeof(ObjectBlock), range)) return false;
+    ObjectBlock* block = (ObjectBlock*)range.data;
+    block->model = model;
+    for (int i = 0; i < 3; i++) block->normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+    block->color = color;
+    block->numSubdiv = numSubdiv;
+    return true;
+}
 
-    view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    view = view * camArcBall.createRotationMatrix();
+// the following draws read their Object block from range
+void bindObject(const StreamRange& range) {
+    if (range.size) glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, range.buffer, range.offset, range.size);
+}
 
-    // cube objects
+// uniforms of the lighting shader that never change (called once it is linked)
+void setupLightingShader() {
+    // projection matrix
     lightingShader->use();
-    lightingShader->setMat4("view", view);
+    lightingShader->setMat4("projection", projection);
+    cameraUBO->attach(lightingShader->ID);
+    bindUniformBlock(lightingShader->ID, "Object", OBJECT_BINDING);
+
+    // transfer texture id to fragment shader
+    lightingShader->setInt("material.diffuse", 0);
+    lightingShader->setInt("material.specular", 1);
+    lightingShader->setFloat("material.shininess", 32);
 
-    // texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-    /*glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);*/
+    lightingShader->setVec3("viewPos", cameraPos);
 
-    // cylinder
-    model = glm::mat4(1.0f);
-    model = model * modelArcBall.createRotationMatrix();
-    lightingShader->setMat4("model", model);
-    cylinder->draw(lightingShader);
+    // transfer lighting parameters to fragment shader
+    // directional light
+    /*lightingShader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+    lightingShader->setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+    lightingShader->setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+    lightingShader->setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);*/
+    
+    // point light 1
+    lightingShader->setVec3("pointLights[0].position", pointLightPositions[0]);
+    lightingShader->setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
+    lightingShader->setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
+    lightingShader->setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
+    lightingShader->setFloat("pointLights[0].constant", 1.0f);
+    lightingShader->setFloat("pointLights[0].linear", 0.09);
+    lightingShader->setFloat("pointLights[0].quadratic", 0.032);
+  
+    // point light 2
+    lightingShader->setVec3("pointLights[1].position", pointLightPositions[1]);
+    lightingShader->setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
+    lightingShader->setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
+    lightingShader->setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
+    lightingShader->setFloat("pointLights[1].constant", 1.0f);
+    lightingShader->setFloat("pointLights[1].linear", 0.09);
+    lightingShader->setFloat("pointLights[1].quadratic", 0.032);
+    
+    // spot light
+    lightingShader->setVec3("spotLight.position", spotLightPosition);
+    lightingShader->setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+    lightingShader->setVec3("spotLight.diffuse", 0.9f, 0.3f, 0.6f);
+    lightingShader->setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
+    lightingShader->setVec3("spotLight.direction", spotLightDirection);
+    lightingShader->setFloat("spotLight.innercutOff", glm::cos(glm::radians(17.5f)));
+    lightingShader->setFloat("spotLight.outercutOff", glm::cos(glm::radians(35.0f)));
+    lightingShader->setFloat("spotLight.constant", 1.0f);
+    lightingShader->setFloat("spotLight.linear", 0.14);
+    lightingShader->setFloat("spotLight.quadratic", 0.07);
+}
+
+void render() {
+    {
+        PROFILE_GPU_ZONE("render");
+
+        // the GPU finished frame N - framesInFlight: its slot, arena block and stream region
+        // are free (low latency: nothing is queued behind this frame)
+        framePipeline->beginFrame();
+        FrameArena::beginFrame();
+        frameStream->beginFrame();
+
+        FrameData &frame = frameData->current();
+        prepareFrame(frame);
+        submitFrame(frame);
+
+        glfwSwapBuffers(mainWindow);
+    }   // the render zone ends before frameEnd() collects the frame
+    frameStream->endFrame();
+    framePipeline->endFrame();
+    if (latency) latency->frameEnd();
+    if (Profiler::enabled()) Profiler::frameEnd();
+    GLStats::frameEnd();
+    FrameArena::endFrame();
+}
+
+// CPU side of a frame: input, matrices and the blocks of every draw written ahead into
+// the stream buffer, while the GPU still works on the previous frames
+void prepareFrame(FrameData& frame) {
+    PROFILE_ZONE("prepareFrame");
+    frame = FrameData();
+
+    // newest arcball state published by the input thread
+    const CameraState &camera = cameraInput->latest();
+    drawnCameraVersion = camera.version;
+    frameDirty = false;
+    if (latency) latency->frameBegin(camera);
+
+    view = glm::lookAt(cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    view = view * camera.camRotation;
+    cameraUBO->write(view, frame.camera);
+
+    if (lightingReady) {
+        // cylinder
+        model = glm::mat4(1.0f);
+        model = model * camera.modelRotation;
+        if (importedMesh) {
+            // fit the imported mesh into a box of size 2 around the origin
+            float* lo = importedMesh->boundsMin;
+            float* hi = importedMesh->boundsMax;
+            float extent = fmax(hi[0] - lo[0], fmax(hi[1] - lo[1], hi[2] - lo[2]));
+            float scale = (extent > 0.0f) ? 2.0f / extent : 1.0f;
+            model = glm::scale(model, glm::vec3(scale, scale, scale));
+            model = glm::translate(model, glm::vec3(-(lo[0] + hi[0]) / 2.0f, -(lo[1] + hi[1]) / 2.0f, -(lo[2] + hi[2]) / 2.0f));
+        }
+        writeObject(model, computeNormalMatrix(model), glm::vec4(1.0f), frame.meshObject,
+                    importedMesh ? 0 : cylinder->numSubdiv);
+    }
 
     // lamps (point lights)
-    lampShader->use();
-    lampShader->setMat4("view", view);
     for (int i = 0; i < 2; i++) {
         model = glm::mat4(1.0f);
         model = glm::translate(model, pointLightPositions[i]);
         model = glm::scale(model, lightSize);
-        lampShader->setMat4("model", model);
-        lampShader->setVec4("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-        lamp->draw(lampShader);
+        writeObject(model, glm::mat3(1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), frame.lampObjects[i]);
     }
 
     // lamps (spot light)
-
-    lampShader->use();
-    lampShader->setMat4("view", view);
     model = glm::mat4(1.0f);
     model = glm::translate(model, spotLightPosition);
     model = glm::scale(model, glm::vec3(0.3f, 0.3f, 0.3f));
-    lampShader->setMat4("model", model);
-    lampShader->setVec4("color", glm::vec4(1.0f, 0.4f, 0.7f, 1.0f));
-    lamp->draw(lampShader);
+    writeObject(model, glm::mat3(1.0f), glm::vec4(1.0f, 0.4f, 0.7f, 1.0f), frame.lampObjects[2]);
+}
+
+// GL side of a frame: binds what prepareFrame() wrote and draws
+void submitFrame(const FrameData& frame) {
+    PROFILE_ZONE("submitFrame");
+    frameStream->flush();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    cameraUBO->bind(frame.camera);
+
+    // cube objects
+    if (lightingReady) {
+        lightingShader->use();
+
+        // texture
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap.id());
+        /*glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specularMap.id());*/
+
+        bindObject(frame.meshObject);
+        if (importedMesh) importedMesh->draw(lightingShader);
+        else cylinder->draw(lightingShader);
+    }
 
-    glfwSwapBuffers(mainWindow);
+    // lamps
+    lampShader->use();
+    for (int i = 0; i < 3; i++) {
+        bindObject(frame.lampObjects[i]);
+        lamp->draw(lampShader);
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -281,15 +576,16 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
     SCR_WIDTH = width;
     SCR_HEIGHT = height;
+    frameDirty = true;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (latency && action == GLFW_PRESS) latency->inputEvent(LatencyMonitor::KEY, 0);
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
     else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-        camArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
-        modelArcBall.init(SCR_WIDTH, SCR_HEIGHT, arcballSpeed, true, true);
+        cameraInput->reset(SCR_WIDTH, SCR_HEIGHT);
     }
     else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
         arcballCamRot = !arcballCamRot;
@@ -303,15 +599,23 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-    if (arcballCamRot)
-        camArcBall.mouseButtonCallback(window, button, action, mods);
-    else
-        modelArcBall.mouseButtonCallback(window, button, action, mods);
+    // queued for the input thread
+    unsigned int id = cameraInput->mouseButton(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, button, action, mods);
+    if (latency) latency->inputEvent(LatencyMonitor::BUTTON, id);
 }
 
 void cursor_position_callback(GLFWwindow* window, double x, double y) {
-    if (arcballCamRot)
-        camArcBall.cursorCallback(window, x, y);
-    else
-        modelArcBall.cursorCallback(window, x, y);
+    // queued for the input thread
+    unsigned int id = cameraInput->cursor(arcballCamRot ? CameraInput::CAMERA : CameraInput::MODEL, x, y);
+    if (latency) latency->inputEvent(LatencyMonitor::CURSOR, id);
+}
+
+// the window was exposed and its contents are lost (e.g. after being covered)
+void window_refresh_callback(GLFWwindow* window) {
+    frameDirty = true;
+}
+
+// true when the last frame drawn is out of date
+bool needsRedraw() {
+    return frameDirty || cameraInput->latest().version != drawnCameraVersion;
 }
@@ -0,0 +1,166 @@
+#pragma once
+
+// AssetPack
+//
+// All shaders and textures of the program in one file, memory-mapped at startup.
+//
+//   - build(): packs a list of loose files into one archive
+//     (InClass10 does this with "InClass10 --pack", run as the post-build step)
+//   - the constructor maps the whole archive with one call, find() returns a
+//     pointer into the mapping: no open/read per asset, no copies
+//   - the constructor checks the header and every entry (terminated name, data
+//     inside the file) once and rejects a malformed pack as a whole
+//   - mount() makes a pack visible to CachedShader and loadTexture(); both
+//     fall back to the loose files when no pack is mounted or a name is missing
+//
+// Layout: header, index (one 64-byte Entry per asset), then the data of each
+// asset aligned to 16 bytes. Names are the paths used to load the loose files.
+
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include "mapped_file.h"
+
+using namespace std;
+
+class AssetPack {
+
+public:
+    AssetPack(const char* packPath) {
+        header = NULL;
+        entries = NULL;
+        if (!file.open(packPath)) return;
+
+        const Header* h = (const Header*)file.data();
+        if (file.size() < sizeof(Header) || memcmp(h->magic, "APAK", 4) != 0 || h->version != PACK_VERSION
+            || h->numEntries > (file.size() - sizeof(Header)) / sizeof(Entry)) {
+            cout << "ERROR::ASSET_PACK::INVALID_FILE: " << packPath << endl;
+            file.close();
+            return;
+        }
+        const Entry* e = (const Entry*)(file.data() + sizeof(Header));
+        for (unsigned int i = 0; i < h->numEntries; i++) {
+            // every name terminated, every asset inside the mapping: find() never reads past the file
+            // (compared without sums that could wrap in a 32-bit size_t)
+            if (memchr(e[i].name, 0, sizeof(e[i].name)) == NULL
+                || e[i].offset > file.size() || e[i].size > file.size() - e[i].offset) {
+                cout << "ERROR::ASSET_PACK::INVALID_ENTRY: " << i << " in " << packPath << endl;
+                file.close();
+                return;
+            }
+        }
+        header = h;
+        entries = e;
+        cout << "asset pack " << packPath << " mapped (" << header->numEntries << " assets)" << endl;
+    }
+
+    ~AssetPack() {
+        if (mounted() == this) mounted() = NULL;
+    }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool isOpen() { return entries != NULL; }
+
+    // data points into the mapping and stays valid as long as the pack
+    bool find(const string &name, const unsigned char* &data, size_t &dataSize) const {
+        if (!entries) return false;
+        // a handful of assets: a linear scan over the index is all it takes
+        for (unsigned int i = 0; i < header->numEntries; i++) {
+            if (name == entries[i].name) {
+                data = file.data() + entries[i].offset;
+                dataSize = entries[i].size;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the pack used by CachedShader and loadTexture() (NULL: loose files only)
+    static AssetPack*& mounted() {
+        static AssetPack* pack = NULL;
+        return pack;
+    }
+
+    void mount() {
+        if (isOpen()) mounted() = this;
+    }
+
+    // writes the files into one pack, returns false if one of them can't be read
+    static bool build(const char* packPath, const vector<string> &files) {
+        vector<Entry> index(files.size());
+        vector<vector<char> > contents(files.size());
+        unsigned int offset = align((unsigned int)(sizeof(Header) + files.size() * sizeof(Entry)));
+
+        for (size_t i = 0; i < files.size(); i++) {
+            if (files[i].size() >= sizeof(index[i].name)) {
+                cout << "ERROR::ASSET_PACK::NAME_TOO_LONG: " << files[i] << endl;
+                return false;
+            }
+            ifstream in(files[i].c_str(), ios::binary);
+            if (!in) {
+                cout << "ERROR::ASSET_PACK::FILE_NOT_SUCCESFULLY_READ: " << files[i] << endl;
+                return false;
+            }
+            contents[i].assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+            memset(&index[i], 0, sizeof(Entry));
+            memcpy(index[i].name, files[i].c_str(), files[i].size());
+            index[i].offset = offset;
+            index[i].size = (unsigned int)contents[i].size();
+            offset = align(offset + index[i].size);
+        }
+
+        ofstream out(packPath, ios::binary | ios::trunc);
+        if (!out) {
+            cout << "ERROR::ASSET_PACK::FILE_NOT_SUCCESFULLY_WRITTEN: " << packPath << endl;
+            return false;
+        }
+        Header h = { { 'A', 'P', 'A', 'K' }, PACK_VERSION, (unsigned int)files.size(), 0 };
+        out.write((const char*)&h, sizeof(h));
+        if (!index.empty()) out.write((const char*)index.data(), index.size() * sizeof(Entry));
+
+        const char zeros[ALIGNMENT] = { 0 };
+        for (size_t i = 0; i < files.size(); i++) {
+            out.write(zeros, index[i].offset - (unsigned int)out.tellp());   // padding
+            if (!contents[i].empty()) out.write(contents[i].data(), contents[i].size());
+        }
+        cout << "asset pack " << packPath << " written (" << files.size() << " assets, "
+            << out.tellp() << " bytes)" << endl;
+        return true;
+    }
+
+private:
+    struct Header {
+        char magic[4];           // "APAK"
+        unsigned int version;
+        unsigned int numEntries;
+        unsigned int reserved;
+    };
+
+    struct Entry {
+        char name[56];           // null-terminated path of the loose file
+        unsigned int offset;     // from the beginning of the pack
+        unsigned int size;       // in bytes
+    };
+
+    static const unsigned int PACK_VERSION = 1;
+    static const unsigned int ALIGNMENT = 16;
+
+    MappedFile file;
+    const Header* header;        // NULL when the pack could not be opened
+    const Entry* entries;
+
+    static unsigned int align(unsigned int offset) {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+};
+
+
+#endif
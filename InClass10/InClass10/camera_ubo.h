@@ -0,0 +1,64 @@
+#pragma once
+
+// CameraUBO
+//
+// View matrix shared by all shaders through a uniform block:
+//
+//   layout (std140) uniform Camera { mat4 view; };
+//
+//   - attach() binds the block of a program to BINDING once, afterwards one
+//     write() + bind() per frame replaces every setMat4("view", ...)
+//   - the matrix is written into the frame's region of a StreamBuffer
+//     (stream_buffer.h): persistently mapped, write() is a plain memcpy
+//
+// Low latency: write() after FramePipeline::beginFrame(), so the view comes from
+// the newest input available once the previous frame is done.
+
+#ifndef CAMERA_UBO_H
+#define CAMERA_UBO_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include "stream_buffer.h"
+
+using namespace std;
+
+class CameraUBO {
+
+public:
+    static const unsigned int BINDING = 0;
+
+    CameraUBO(StreamBuffer* stream) {
+        this->stream = stream;
+    }
+
+    // the program's Camera block reads from this buffer
+    void attach(unsigned int program) {
+        unsigned int index = glGetUniformBlockIndex(program, "Camera");
+        if (index == GL_INVALID_INDEX) {
+            cout << "CameraUBO::attach error: no Camera uniform block in program " << program << endl;
+            return;
+        }
+        glUniformBlockBinding(program, index, BINDING);
+    }
+
+    // the view matrix of this frame, written while preparing it
+    bool write(const glm::mat4 &view, StreamRange &range) {
+        return stream->writeUniform(glm::value_ptr(view), BLOCK_SIZE, range);
+    }
+
+    // when submitting the frame: the following draws read the view from range
+    void bind(const StreamRange &range) {
+        if (range.size) glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, range.buffer, range.offset, range.size);
+    }
+
+private:
+    static const int BLOCK_SIZE = 16 * sizeof(float);    // std140 mat4
+
+    StreamBuffer* stream;    // not owned
+};
+
+
+#endif
@@ -11,14 +11,45 @@
 //   # of vertex coordinate values = (# of vertices) * 3
 //
 // Vertex shader: the location (0: position attrib (vec3), 1: color (vec3))
+//
+// Procedural mode (vertex pulling): no vertex attributes are stored at all.
+//   procedural_cylinder.vs rebuilds position, normal and texcoord from gl_VertexID
+//   and numSubdiv (Object uniform block, written by the caller with the model),
+//   the only buffer holds per-instance parameters
+//   (0: offset (vec3), 1: size (vec2: radius, height)), one instance per addInstance().
 // Fragment shader: should catch the vertex color from the vertex shader
+//
+// Mesh cache: the non-procedural mesh is generated once and saved to
+//   cylinder_<N>_<radius>_<height>.mesh (mesh_file.h), later runs map that file
+//   and upload it with a single glBufferData() (positions|normals|colors|texcoords).
+//
+// Attribute stripping: streams (bit i: attribute location i, see shader_interface.h)
+//   selects the attributes that are generated, uploaded and enabled in the VAO;
+//   pass activeAttributeMask() of the shader that draws the cylinder.
+//
+// The vertex streams are generated into scratch memory of the frame arena
+//   (frame_arena.h), uploaded (and saved) right away: a cylinder keeps no copy.
+//
+// The VAO and buffers are owned (gpu_resource.h): deleting the cylinder frees them.
+// With a BufferPool the streams (or the cached mesh) are ranges of the pool's shared
+//   buffers instead of a buffer each: creating or deleting a cylinder allocates no
+//   GL buffer (the procedural instance buffer is always its own).
 
 #ifndef CYLINDER_H
 #define CYLINDER_H
 
 #include <cmath>
 #include <iostream>
+#include <string>
+#include <cstdio>
+#include <set>
 #include "shader.h"
+#include "mesh_file.h"
+#include "shader_interface.h"
+#include "profiler.h"
+#include "gpu_resource.h"
+#include "buffer_pool.h"
+#include "frame_arena.h"
 
 using namespace std;
 
@@ -34,6 +65,8 @@ public:
     int numVertices;     // numVertices = numSubdiv * 2 * 3
     float radius;
     float height;
+    bool procedural;     // vertex pulling mode
+    unsigned int streams;     // attribute locations built for (0: position, 1: normal, 2: color, 3: texcoord)
     
     Cylinder() {
         N = MIN_N;
@@ -42,11 +75,15 @@ public:
         radius = 1.0f;
         height = 1.0f;
         colorIndex = 0;
+        procedural = false;
+        streams = ALL_ATTRIBUTES;
+        pool = NULL;
         createBuffers();
         updateBuffers();
     }
     
-    Cylinder(int N, float radius, float height) {
+    Cylinder(int N, float radius, float height, bool procedural = false, unsigned int streams = ALL_ATTRIBUTES,
+             BufferPool* pool = NULL) {
         if (N < MIN_N || MAX_N < N) {
             cout << "Cylinder constructor error illegal N: " << N << endl;
             cout << "N must be in [" << MIN_N << ", " << MAX_N << "]" << endl;
@@ -57,26 +94,128 @@ public:
         this->numVertices = this->numSubdiv * 6;
         this->radius = radius;
         this->height = height;
+        this->procedural = procedural;
+        this->streams = streams | 1;   // position is always needed
+        this->pool = pool;
         colorIndex = 0;
-        createBuffers();
-        updateBuffers();
+        if (procedural) {
+            createInstanceBuffer();
+            addInstance(0.0f, 0.0f, 0.0f, radius, height);
+        }
+        else {
+            createBuffers();
+            string path = meshPath();
+            if (!loadMesh(path.c_str())) {
+                updateBuffers(path.c_str());
+            }
+        }
     }
     
-    void draw(Shader *shader) {
+    // ShaderType: Shader or CachedShader
+    template <class ShaderType>
+    void draw(ShaderType *shader) {
+        PROFILE_GPU_ZONE("Cylinder::draw");
         shader->use();
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, numVertices);
+        if (!procedural && !checkedPrograms.count(shader->ID)) {
+            checkedPrograms.insert(shader->ID);
+            if (activeAttributeMask(shader->ID) & ~streams)
+                cout << "Cylinder::draw warning: the shader reads attributes the cylinder was not built with" << endl;
+        }
+        glBindVertexArray(VAO.id());
+        if (procedural) {
+            glDrawArraysInstanced(GL_TRIANGLES, 0, numVertices, numInstances);
+        }
+        else {
+            glDrawArrays(GL_TRIANGLES, 0, numVertices);
+        }
         glBindVertexArray(0);
     };
 
+    // procedural mode: one more copy drawn by the same call
+    void addInstance(float x, float y, float z, float radius, float height) {
+        if (!procedural || numInstances >= MAX_INSTANCES) return;
+        float *p = &instances[numInstances * 5];
+        p[0] = x; p[1] = y; p[2] = z;
+        p[3] = radius; p[4] = height;
+        numInstances++;
+        updateInstanceBuffer();
+    }
+
+    // change subdivision/radius/height; in procedural mode this only updates a few floats
+    void setShape(int N, float radius, float height) {
+        if (N < MIN_N || MAX_N < N) {
+            cout << "Cylinder::setShape error illegal N: " << N << endl;
+            return;
+        }
+        this->N = N;
+        this->numSubdiv = (int)pow(2.0, N);
+        this->numVertices = this->numSubdiv * 6;
+        this->radius = radius;
+        this->height = height;
+        if (procedural) {
+            instances[3] = radius;
+            instances[4] = height;
+            updateInstanceBuffer();
+        }
+        else {
+            updateBuffers();
+        }
+    }
+
+    // cache file of the current shape
+    string meshPath() {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "cylinder_%d_%g_%g_%x.mesh", N, radius, height, streams & 0xF);
+        return string(buf);
+    }
+
+    // writes the generated streams (data[i]: attribute location i) as one block per attribute
+    bool saveMesh(const char* path, const GLfloat* const data[4]) {
+        const unsigned int components[4] = { 3, 3, 3, 2 };
+        FrameVector<float> block;
+        block.reserve(numVertices * 11);
+        MeshDesc mesh;
+        for (unsigned int loc = 0; loc < 4; loc++) {
+            if (!hasStream(loc)) continue;
+            MeshAttribute a = { loc, components[loc], (unsigned int)(block.size() * sizeof(float)),
+                                components[loc] * (unsigned int)sizeof(float) };
+            mesh.attributes.push_back(a);
+            block.insert(block.end(), data[loc], data[loc] + numVertices * components[loc]);
+        }
+        mesh.vertexData = block.data();
+        mesh.vertexBytes = (unsigned int)(block.size() * sizeof(float));
+        mesh.numVertices = numVertices;
+        MeshFile::computeBounds(data[0], numVertices, mesh.boundsMin, mesh.boundsMax);
+        mesh.generator = GENERATOR_VERSION;
+        return MeshFile::save(path, mesh);
+    }
+
+    // maps a cache file into VBO[0] (pooled: a range of its own), false if it is missing, stale or doesn't match this shape
+    bool loadMesh(const char* path) {
+        MeshFile mesh(path);
+        if (!mesh.isOpen() || mesh.generator() != GENERATOR_VERSION || mesh.numVertices() != (unsigned int)numVertices)
+            return false;
+        if (pool) {
+            pool->allocate(mesh.vertexBytes(), cachedRange);
+            mesh.uploadTo(VAO.id(), cachedRange.buffer(), cachedRange.offset());
+            return true;
+        }
+        mesh.upload(VAO.id(), VBO[0].id());
+        VBO[0].setSize(mesh.vertexBytes());
+        return true;
+    }
+
+    bool hasStream(unsigned int location) { return (streams >> location) & 1; }
+
 private:
     
-    GLfloat vertices[1152];   // 64 * 2 * 3 * 3
-    GLfloat colors[1152];     // 64 * 2 * 3 * 3
-    GLfloat texcoords[384];   // 32 * 2 * 3 * 2, for InClass10
-    GLfloat normal[1152];
+    // bump whenever updateBuffers() generates different data: older cache files are regenerated
+    static const unsigned int GENERATOR_VERSION = 1;
+    
+    static const int MAX_VERTICES = 384;   // 64 * 2 * 3 (N = MAX_N)
 
     int colorIndex;
+    set<unsigned int> checkedPrograms;   // programs whose attributes draw() already compared with streams
 
     float mainColors[15] = {
         .7f, .0f, .0f,
@@ -86,45 +225,105 @@ private:
         .7f, .0f, .7f,
     };
     
-    unsigned int VAO;
-    // VBO[0]: for position, VBO[1]: for color, VBO[2]: texcoords (InClass06)
-    unsigned int VBO[4];
+    GpuVertexArray VAO;
+    // VBO[0]: for position, VBO[1]: for normal, VBO[2]: for color, VBO[3]: texcoords
+    GpuBuffer VBO[4];
+
+    // pooled: ranges[i] replaces VBO[i] (taken by updateBuffers()), cachedRange holds a loaded mesh
+    BufferPool* pool;
+    BufferRange ranges[4];
+    BufferRange cachedRange;
+
+    // procedural mode: per-instance (x, y, z, radius, height)
+    static const int MAX_INSTANCES = 256;
+    GLfloat instances[MAX_INSTANCES * 5];
+    int numInstances = 0;
+    
+    void createInstanceBuffer() {
+        
+        VAO.create("Cylinder");
+        VBO[0].create("Cylinder");
+        
+        glBindVertexArray(VAO.id());
+        
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+        glBufferData(GL_ARRAY_BUFFER, sizeof(instances), 0, GL_DYNAMIC_DRAW);
+        VBO[0].setSize(sizeof(instances));
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(0, 1);
+        glVertexAttribDivisor(1, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        
+        glBindVertexArray(0);
+    }
+    
+    void updateInstanceBuffer() {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, numInstances * 5 * sizeof(float), instances);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
     
     void createBuffers() {
         
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(4, VBO);        // 2 -> 3 for InClass08 (texture) 
+        VAO.create("Cylinder");
+        // pooled: no buffer at all (a cached mesh needs no stream ranges)
+        if (pool) return;
+
+        // a buffer per stream that is built
+        for (unsigned int loc = 0; loc < 4; loc++) {
+            if (hasStream(loc)) VBO[loc].create("Cylinder");
+        }
         
-        glBindVertexArray(VAO);
+        glBindVertexArray(VAO.id());
         
         // reserve space for position attributes
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), 0, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0].id());
+        glBufferData(GL_ARRAY_BUFFER, streamBytes(0), 0, GL_STATIC_DRAW);
+        VBO[0].setSize(streamBytes(0));
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         
         // reserve space for normal coordinates: for InClass10
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(normal), 0, GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasStream(1)) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO[1].id());
+            glBufferData(GL_ARRAY_BUFFER, streamBytes(1), 0, GL_STATIC_DRAW);
+            VBO[1].setSize(streamBytes(1));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
 
         // reserve space for color attributes
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(colors), 0, GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasStream(2)) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO[2].id());
+            glBufferData(GL_ARRAY_BUFFER, streamBytes(2), 0, GL_STATIC_DRAW);
+            VBO[2].setSize(streamBytes(2));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         
         // reserve space for texture coordinates: for InClass10
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[3]);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(texcoords), 0, GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasStream(3)) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO[3].id());
+            glBufferData(GL_ARRAY_BUFFER, streamBytes(3), 0, GL_STATIC_DRAW);
+            VBO[3].setSize(streamBytes(3));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         
 
         glBindVertexArray(0);
         
     }
     
-    void updateBuffers() {
+    // savePath: also written to this mesh cache file
+    void updateBuffers(const char* savePath = NULL) {
+        PROFILE_ZONE("Cylinder::updateBuffers");
         
-        // compute vertex attributes (for position and color)
+        // compute vertex attributes (only the streams the shader reads) into frame scratch
+        bool hasNormal = hasStream(1), hasColor = hasStream(2), hasTexcoord = hasStream(3);
+        GLfloat* vertices = FrameArena::allocateArray<GLfloat>(numVertices * 3);
+        GLfloat* normal = hasNormal ? FrameArena::allocateArray<GLfloat>(numVertices * 3) : NULL;
+        GLfloat* colors = hasColor ? FrameArena::allocateArray<GLfloat>(numVertices * 3) : NULL;
+        GLfloat* texcoords = hasTexcoord ? FrameArena::allocateArray<GLfloat>(numVertices * 2) : NULL;
         double angleStep = (PI * 2.0) / numSubdiv;
         double theta = 0.0;
         float halfHeight = height / 2.0;
@@ -150,47 +349,61 @@ private:
             vertices[j+1] = halfHeight;
             vertices[j+2] = radius * sin(theta);
 
-            normal[j] = radius * cos(theta);
-            normal[j + 1] = halfHeight;
-            normal[j + 2] = radius * sin(theta);
+            if (hasNormal) {
+                normal[j] = radius * cos(theta);
+                normal[j + 1] = halfHeight;
+                normal[j + 2] = radius * sin(theta);
+            }
             
-            colors[j] = mainColors[k];
-            colors[j+1] = mainColors[k+1];
-            colors[j+2] = mainColors[k+2];
+            if (hasColor) {
+                colors[j] = mainColors[k];
+                colors[j+1] = mainColors[k+1];
+                colors[j+2] = mainColors[k+2];
+            }
             
             // second vertex
             vertices[j+3] = vertices[j];
             vertices[j+4] = -halfHeight;
             vertices[j+5] = vertices[j+2];
 
-            normal[j + 3] = vertices[j];
-            normal[j + 4] = -halfHeight;
-            normal[j + 5] = vertices[j + 2];
+            if (hasNormal) {
+                normal[j + 3] = vertices[j];
+                normal[j + 4] = -halfHeight;
+                normal[j + 5] = vertices[j + 2];
+            }
             
-            colors[j+3] = mainColors[k];
-            colors[j+4] = mainColors[k+1];
-            colors[j+5] = mainColors[k+2];
+            if (hasColor) {
+                colors[j+3] = mainColors[k];
+                colors[j+4] = mainColors[k+1];
+                colors[j+5] = mainColors[k+2];
+            }
 
             // third vertex
             vertices[j+6] = radius * cos(phi);
             vertices[j+7] = halfHeight;
             vertices[j+8] = radius * sin(phi);
 
-            normal[j + 6] = radius * cos(phi);
-            normal[j + 7] = halfHeight;
-            normal[j + 8] = radius * sin(phi);
+            if (hasNormal) {
+                normal[j + 6] = radius * cos(phi);
+                normal[j + 7] = halfHeight;
+                normal[j + 8] = radius * sin(phi);
+            }
             
-            colors[j+6] = mainColors[k];
-            colors[j+7] = mainColors[k+1];
-            colors[j+8] = mainColors[k+2];
+            if (hasColor) {
+                colors[j+6] = mainColors[k];
+                colors[j+7] = mainColors[k+1];
+                colors[j+8] = mainColors[k+2];
+            }
             
             // texture coordinates (for first triangle)
-            texcoords[q] = curTex;
-            texcoords[q+1] = 1.0f;
-            texcoords[q+2] = curTex;
-            texcoords[q+3] = 0.0f;
-            texcoords[q+4] = nextTex;
-            texcoords[q+5] = 1.0f;
+            if (hasTexcoord) {
+                texcoords[q] = curTex;
+                texcoords[q+1] = 1.0f;
+                texcoords[q+2] = curTex;
+                texcoords[q+3] = 0.0f;
+                texcoords[q+4] = nextTex;
+                texcoords[q+5] = 1.0f;
+            }
             
             // second triangle
             
@@ -198,45 +411,59 @@ private:
             vertices[j+10] = vertices[j+7];
             vertices[j+11] = vertices[j+8];
 
-            normal[j + 9] = vertices[j + 6];
-            normal[j + 10] = vertices[j + 7];
-            normal[j + 11] = vertices[j + 8];
+            if (hasNormal) {
+                normal[j + 9] = vertices[j + 6];
+                normal[j + 10] = vertices[j + 7];
+                normal[j + 11] = vertices[j + 8];
+            }
             
-            colors[j+9] = mainColors[k];
-            colors[j+10] = mainColors[k+1];
-            colors[j+11] = mainColors[k+2];
+            if (hasColor) {
+                colors[j+9] = mainColors[k];
+                colors[j+10] = mainColors[k+1];
+                colors[j+11] = mainColors[k+2];
+            }
             
             vertices[j+12] = vertices[j+3];
             vertices[j+13] = vertices[j+4];
             vertices[j+14] = vertices[j+5];
 
-            normal[j + 12] = vertices[j + 3];
-            normal[j + 13] = vertices[j + 4];
-            normal[j + 14] = vertices[j + 5];
+            if (hasNormal) {
+                normal[j + 12] = vertices[j + 3];
+                normal[j + 13] = vertices[j + 4];
+                normal[j + 14] = vertices[j + 5];
+            }
             
-            colors[j+12] = mainColors[k];
-            colors[j+13] = mainColors[k+1];
-            colors[j+14] = mainColors[k+2];
+            if (hasColor) {
+                colors[j+12] = mainColors[k];
+                colors[j+13] = mainColors[k+1];
+                colors[j+14] = mainColors[k+2];
+            }
             
             vertices[j+15] = vertices[j+6];
             vertices[j+16] = -halfHeight;
             vertices[j+17] = vertices[j+8];
 
-            normal[j + 15] = vertices[j + 6];
-            normal[j + 16] = -halfHeight;
-            normal[j + 17] = vertices[j + 8];
+            if (hasNormal) {
+                normal[j + 15] = vertices[j + 6];
+                normal[j + 16] = -halfHeight;
+                normal[j + 17] = vertices[j + 8];
+            }
             
-            colors[j+15] = mainColors[k];
-            colors[j+16] = mainColors[k+1];
-            colors[j+17] = mainColors[k+2];
+            if (hasColor) {
+                colors[j+15] = mainColors[k];
+                colors[j+16] = mainColors[k+1];
+                colors[j+17] = mainColors[k+2];
+            }
 
             // texture coordinates (for second triangle)
-            texcoords[q+6] = nextTex;
-            texcoords[q+7] = 1.0f;
-            texcoords[q+8] = curTex;
-            texcoords[q+9] = 0.0f;
-            texcoords[q+10] = nextTex;
-            texcoords[q+11] = 0.0f;
+            if (hasTexcoord) {
+                texcoords[q+6] = nextTex;
+                texcoords[q+7] = 1.0f;
+                texcoords[q+8] = curTex;
+                texcoords[q+9] = 0.0f;
+                texcoords[q+10] = nextTex;
+                texcoords[q+11] = 0.0f;
+            }
             
             // proceed to next step
             colorIndex = (colorIndex + 1) % 6;
@@ -244,34 +471,64 @@ private:
             curTex = curTex + texStep;
         }
         
-        glBindVertexArray(VAO);
+        if (pool) allocateRanges();
+
+        glBindVertexArray(VAO.id());
         
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, streamBuffer(0));
+        glBufferSubData(GL_ARRAY_BUFFER, streamOffset(0), numVertices * 3 * sizeof(GLfloat), vertices);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(size_t)streamOffset(0));
         glEnableVertexAttribArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(normal), normal);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasNormal) {
+            glBindBuffer(GL_ARRAY_BUFFER, streamBuffer(1));
+            glBufferSubData(GL_ARRAY_BUFFER, streamOffset(1), numVertices * 3 * sizeof(GLfloat), normal);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(size_t)streamOffset(1));
+            glEnableVertexAttribArray(1);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(colors), colors);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasColor) {
+            glBindBuffer(GL_ARRAY_BUFFER, streamBuffer(2));
+            glBufferSubData(GL_ARRAY_BUFFER, streamOffset(2), numVertices * 3 * sizeof(GLfloat), colors);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(size_t)streamOffset(2));
+            glEnableVertexAttribArray(2);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         
-        glBindBuffer(GL_ARRAY_BUFFER, VBO[3]);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(texcoords), texcoords);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
-        glEnableVertexAttribArray(3);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (hasTexcoord) {
+            glBindBuffer(GL_ARRAY_BUFFER, streamBuffer(3));
+            glBufferSubData(GL_ARRAY_BUFFER, streamOffset(3), numVertices * 2 * sizeof(GLfloat), texcoords);
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(size_t)streamOffset(3));
+            glEnableVertexAttribArray(3);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
         
         glBindVertexArray(0);
+
+        if (savePath) {
+            const GLfloat* const data[4] = { vertices, normal, colors, texcoords };
+            saveMesh(savePath, data);
+        }
     };
+
+    // pooled: a range per stream that is built, the cached mesh is no longer drawn
+    void allocateRanges() {
+        for (unsigned int loc = 0; loc < 4; loc++) {
+            if (hasStream(loc) && !ranges[loc].valid()) pool->allocate(streamBytes(loc), ranges[loc]);
+        }
+        cachedRange.release();
+    }
+
+    // room for stream loc at the largest N
+    static unsigned int streamBytes(unsigned int loc) {
+        return MAX_VERTICES * (loc == 3 ? 2 : 3) * sizeof(GLfloat);
+    }
+
+    // buffer and byte offset that hold stream loc
+    unsigned int streamBuffer(unsigned int loc) { return pool ? ranges[loc].buffer() : VBO[loc].id(); }
+    unsigned int streamOffset(unsigned int loc) { return pool ? ranges[loc].offset() : 0; }
     
 };
 
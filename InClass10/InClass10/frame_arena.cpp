@@ -0,0 +1,90 @@
+// Counting replacement of the global operator new/delete for FrameArena
+//
+// Debug builds (FRAME_ARENA_COUNT_HEAP, see frame_arena.h) replace the whole set:
+// plain, array, nothrow, sized and (C++17) aligned forms, so every heap allocation
+// of the program goes through FrameArena::heapCounter(). Release builds compile
+// this file to nothing and keep the library operators.
+
+#include "frame_arena.h"
+
+#if FRAME_ARENA_COUNT_HEAP
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+using namespace std;
+
+static void* countedAllocate(size_t size) {
+    FrameArena::heapCounter()++;
+    return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    void* p = countedAllocate(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = countedAllocate(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return countedAllocate(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#ifdef __cpp_aligned_new
+
+// over-aligned: malloc'd with room for the alignment, the malloc'd pointer is stored just before the block
+static void* countedAllocateAligned(size_t size, size_t alignment) {
+    FrameArena::heapCounter()++;
+    void* raw = malloc(size + alignment + sizeof(void*));
+    if (!raw) return NULL;
+    uintptr_t start = ((uintptr_t)raw + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((void**)start)[-1] = raw;
+    return (void*)start;
+}
+
+static void freeAligned(void* p) {
+    if (p) free(((void**)p)[-1]);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    void* p = countedAllocateAligned(size, (size_t)alignment);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    void* p = countedAllocateAligned(size, (size_t)alignment);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return countedAllocateAligned(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return countedAllocateAligned(size, (size_t)alignment);
+}
+
+void operator delete(void* p, align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { freeAligned(p); }
+
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+#pragma once
+
+// FrameArena
+//
+// Bump allocator for data that only lives for a frame (mesh generation scratch,
+// uniform payloads, draw lists):
+//
+//   FrameArena::beginFrame();                           // start of render()
+//   GLfloat* scratch = FrameArena::allocateArray<GLfloat>(n);
+//   FrameVector<DrawItem> items;                        // vector on the arena
+//   ...                                                 // nothing is ever freed
+//   FrameArena::endFrame();                             // after glfwSwapBuffers()
+//
+//   - NUM_FRAMES blocks used in turn: beginFrame() rewinds the block of the frame
+//     NUM_FRAMES back, so data of the previous frames (e.g. still read by the
+//     GPU, FramePipeline keeps at most NUM_FRAMES in flight) stays valid
+//   - allocations between frames (startup) go to the current block too
+//   - a frame that outgrows its block falls back to the heap (freed when the
+//     block is reused) and is counted as an overflow: raise the capacity
+//   - FrameAllocator<T>: STL allocator on the arena (deallocate is a no-op),
+//     FrameVector<T> the vector that uses it
+//
+// Debug builds (FRAME_ARENA_COUNT_HEAP) count the operator new calls of each
+// thread; endFrame() reports every frame after WARMUP_FRAMES that still did a
+// heap allocation on the render thread (asserts with FRAME_ARENA_STRICT).
+// warmUp() after a scene change gives lazy initialization another WARMUP_FRAMES.
+// The measurement tools (profiler, latency monitor, GL stats) allocate as they record.
+// The counting operator new/delete replacements are in frame_arena.cpp, which
+// must be compiled into the program.
+//
+// GL thread only.
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#ifndef FRAME_ARENA_COUNT_HEAP
+#ifdef NDEBUG
+#define FRAME_ARENA_COUNT_HEAP 0
+#else
+#define FRAME_ARENA_COUNT_HEAP 1
+#endif
+#endif
+
+#ifndef FRAME_ARENA_STRICT
+#define FRAME_ARENA_STRICT 0
+#endif
+
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cassert>
+#include <cstddef>
+
+using namespace std;
+
+class FrameArena {
+
+public:
+    static const int NUM_FRAMES = 3;                  // >= frames in flight (FramePipeline)
+    static const size_t DEFAULT_CAPACITY = 1 << 20;   // bytes per frame
+    static const size_t ALIGNMENT = 16;
+    static const int WARMUP_FRAMES = 3;               // first frames may allocate (caches, lazy init)
+
+    // before the first allocation
+    static void setCapacity(size_t bytesPerFrame) {
+        FrameArena &a = instance();
+        if (a.storage) {
+            cout << "FrameArena::setCapacity error: the arena is already in use" << endl;
+            return;
+        }
+        a.blockSize = bytesPerFrame;
+    }
+
+    static void beginFrame() {
+        FrameArena &a = instance();
+        a.frame++;
+        a.block = (int)(a.frame % NUM_FRAMES);
+        a.offset[a.block] = 0;
+        a.releaseOverflow(a.block);
+        a.heapAtBegin = heapAllocations();
+    }
+
+    static void endFrame() {
+        FrameArena &a = instance();
+        if (a.offset[a.block] > a.peakBytes) a.peakBytes = a.offset[a.block];
+#if FRAME_ARENA_COUNT_HEAP
+        unsigned long long n = heapAllocations() - a.heapAtBegin;
+        if (n > 0 && a.frame > a.steadyFrom) {
+            a.numDirtyFrames++;
+            if (a.numDirtyFrames <= MAX_MESSAGES)
+                cout << "ERROR::FRAME_ARENA::HEAP_ALLOCATION: " << n << " in frame " << a.frame << endl;
+            assert(!FRAME_ARENA_STRICT && "steady-state frames must not allocate from the heap");
+        }
+#endif
+    }
+
+    // the next WARMUP_FRAMES frames may allocate (new meshes, shaders, ...)
+    static void warmUp() {
+        FrameArena &a = instance();
+        a.steadyFrom = a.frame + WARMUP_FRAMES;
+    }
+
+    static void* allocate(size_t bytes, size_t alignment = ALIGNMENT) {
+        FrameArena &a = instance();
+        if (!a.storage) a.storage.reset(new char[a.blockSize * NUM_FRAMES]);
+        size_t start = (a.offset[a.block] + alignment - 1) / alignment * alignment;
+        if (start + bytes > a.blockSize) {
+            // too small for this frame: heap until the block comes around again
+            a.numOverflows++;
+            char* p = new char[bytes];
+            a.overflow[a.block].push_back(p);
+            return p;
+        }
+        a.offset[a.block] = start + bytes;
+        return a.storage.get() + a.block * a.blockSize + start;
+    }
+
+    template <class T>
+    static T* allocateArray(size_t count) {
+        return (T*)allocate(count * sizeof(T), alignof(T) > ALIGNMENT ? alignof(T) : ALIGNMENT);
+    }
+
+    static size_t used() { return instance().offset[instance().block]; }
+    static size_t peak() { return instance().peakBytes; }
+    static size_t capacity() { return instance().blockSize; }
+    static unsigned long long frameIndex() { return instance().frame; }
+
+    // operator new calls of the calling thread so far (0 without FRAME_ARENA_COUNT_HEAP)
+    static unsigned long long heapAllocations() {
+#if FRAME_ARENA_COUNT_HEAP
+        return heapCounter();
+#else
+        return 0;
+#endif
+    }
+
+    // used by the replacement operator new (frame_arena.cpp)
+    static unsigned long long& heapCounter() {
+        thread_local unsigned long long n = 0;
+        return n;
+    }
+
+    static void report() {
+        FrameArena &a = instance();
+        cout << "FRAME ARENA: " << a.frame << " frames, peak " << a.peakBytes << " of " << a.blockSize
+             << " bytes, " << a.numOverflows << " overflows";
+#if FRAME_ARENA_COUNT_HEAP
+        cout << ", " << a.numDirtyFrames << " frames with heap allocations";
+#endif
+        cout << endl;
+    }
+
+private:
+    static const int MAX_MESSAGES = 10;
+
+    unique_ptr<char[]> storage;             // NUM_FRAMES blocks of blockSize bytes
+    size_t blockSize;
+    size_t offset[NUM_FRAMES];              // bytes used in each block
+    vector<char*> overflow[NUM_FRAMES];     // heap fallbacks of each block
+    int block;                              // block of the current frame
+    unsigned long long frame;
+    size_t peakBytes;
+    int numOverflows;
+    int numDirtyFrames;                     // frames after the warm-up that allocated
+    unsigned long long steadyFrom;          // last frame of the warm-up
+    unsigned long long heapAtBegin;
+
+    FrameArena() {
+        blockSize = DEFAULT_CAPACITY;
+        for (int i = 0; i < NUM_FRAMES; i++) offset[i] = 0;
+        block = 0;
+        frame = 0;
+        peakBytes = 0;
+        numOverflows = 0;
+        numDirtyFrames = 0;
+        steadyFrom = WARMUP_FRAMES;
+        heapAtBegin = 0;
+    }
+
+    ~FrameArena() {
+        for (int i = 0; i < NUM_FRAMES; i++) releaseOverflow(i);
+    }
+
+    static FrameArena& instance() {
+        static FrameArena arena;
+        return arena;
+    }
+
+    void releaseOverflow(int block) {
+        vector<char*> &o = overflow[block];
+        for (size_t i = 0; i < o.size(); i++) delete[] o[i];
+        o.clear();
+    }
+};
+
+// STL allocator on the frame arena: containers must not outlive the frame
+template <class T>
+class FrameAllocator {
+
+public:
+    typedef T value_type;
+
+    FrameAllocator() {}
+    template <class U> FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t n) { return FrameArena::allocateArray<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    template <class U> bool operator==(const FrameAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <class T>
+using FrameVector = vector<T, FrameAllocator<T> >;
+
+
+#endif
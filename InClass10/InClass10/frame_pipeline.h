@@ -0,0 +1,125 @@
+#pragma once
+
+// FramePipeline
+//
+// Frames in flight: the CPU prepares and submits frame N while the GPU still
+// executes the frames before it, so a frame costs the slower of CPU and GPU
+// instead of their sum:
+//
+//   FramePipeline pipeline(2);
+//   pipeline.beginFrame();              // waits until frame N - framesInFlight is done
+//   FrameData &frame = ring.current();  // FrameRing<FrameData> ring(pipeline)
+//   ...                                 // prepare (CPU only), then submit (GL)
+//   glfwSwapBuffers(window);
+//   pipeline.endFrame();                // fence of frame N (FrameThrottle)
+//
+//   - framesInFlight = 1: the CPU starts a frame only once the GPU finished the
+//     previous one (lowest latency, CPU and GPU take turns)
+//   - slot() (0 .. framesInFlight - 1) indexes per-frame resources: it is reused
+//     only after the GPU finished the frame that used it last. FrameRing<T> keeps
+//     one T per slot; other rings (StreamBuffer, FrameArena) need at least
+//     framesInFlight regions
+//   - report(): CPU time per frame (beginFrame() to endFrame(), a vsync wait in
+//     glfwSwapBuffers() included) and time waiting for the GPU; a pipeline that
+//     waits in most frames is GPU bound
+//
+// GL thread only.
+
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "frame_throttle.h"
+#include "frame_arena.h"
+#include "profiler.h"
+
+using namespace std;
+
+class FramePipeline {
+
+public:
+    static const int MAX_FRAMES_IN_FLIGHT = FrameArena::NUM_FRAMES;
+
+    FramePipeline(int framesInFlight = 2) : throttle(clampFrames(framesInFlight)) {
+        numInFlight = clampFrames(framesInFlight);
+        if (numInFlight != framesInFlight)
+            cout << "FramePipeline error: " << framesInFlight << " frames in flight, must be in [1, "
+                 << MAX_FRAMES_IN_FLIGHT << "]" << endl;
+        frame = 0;
+        cpuMs = 0.0;
+        waitMs = 0.0;
+        numWaited = 0;
+    }
+
+    // before the first GL call and the first write to a per-frame resource
+    void beginFrame() {
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("FramePipeline::wait");
+            throttle.wait();
+        }
+        begin = chrono::steady_clock::now();
+        double waited = chrono::duration<double, milli>(begin - t0).count();
+        waitMs += waited;
+        if (waited > WAIT_THRESHOLD_MS) numWaited++;
+    }
+
+    // after glfwSwapBuffers(): the frame's slot is in flight until its fence signals
+    void endFrame() {
+        throttle.frameSubmitted();
+        cpuMs += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        frame++;
+    }
+
+    int framesInFlight() const { return numInFlight; }
+    int slot() const { return (int)(frame % numInFlight); }
+    unsigned long long frameIndex() const { return frame; }
+
+    void report() {
+        if (frame == 0) return;
+        cout << fixed << setprecision(2);
+        cout << "FRAME PIPELINE: " << numInFlight << " frames in flight, " << frame << " frames, CPU "
+             << cpuMs / frame << " ms/frame, waited for the GPU " << waitMs / frame << " ms/frame in "
+             << numWaited << " frames (" << (numWaited * 2 > frame ? "GPU" : "CPU") << " bound)" << endl;
+        cout.unsetf(ios::fixed);
+    }
+
+private:
+    static constexpr double WAIT_THRESHOLD_MS = 0.05;    // shorter waits are the fence check itself
+
+    FrameThrottle throttle;      // a fence per frame in flight
+    int numInFlight;
+    unsigned long long frame;    // frames submitted
+    chrono::steady_clock::time_point begin;
+    double cpuMs, waitMs;
+    unsigned long long numWaited;
+
+    static int clampFrames(int framesInFlight) {
+        if (framesInFlight < 1) return 1;
+        if (framesInFlight > MAX_FRAMES_IN_FLIGHT) return MAX_FRAMES_IN_FLIGHT;
+        return framesInFlight;
+    }
+};
+
+// one T per frame in flight, current() belongs to the frame being prepared
+template <class T>
+class FrameRing {
+
+public:
+    FrameRing(const FramePipeline &pipeline) : pipeline(pipeline), items(pipeline.framesInFlight()) {}
+
+    T& current() { return items[pipeline.slot()]; }
+    T& operator[](int slot) { return items[slot]; }
+    int size() const { return (int)items.size(); }
+
+private:
+    const FramePipeline &pipeline;
+    vector<T> items;
+};
+
+
+#endif
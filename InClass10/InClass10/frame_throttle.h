@@ -0,0 +1,73 @@
+#pragma once
+
+// FrameThrottle
+//
+// Limits how many frames the driver may queue ahead of the GPU.
+// Drivers usually let the CPU run 2-3 frames ahead, which adds as many frames
+// of input latency; with maxQueued = 1 the CPU starts a frame only once the
+// GPU finished the previous one.
+//
+//   - frameSubmitted() after glfwSwapBuffers(): puts a fence in the command stream
+//   - wait() before reading the input of the next frame: blocks on the fence of
+//     the frame maxQueued frames back
+
+#ifndef FRAME_THROTTLE_H
+#define FRAME_THROTTLE_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+class FrameThrottle {
+
+public:
+    FrameThrottle(int maxQueued = 1) {
+        if (maxQueued < 1) maxQueued = 1;
+        fences.assign(maxQueued, (GLsync)0);
+        next = 0;
+    }
+
+    ~FrameThrottle() {
+        for (size_t i = 0; i < fences.size(); i++) {
+            if (fences[i]) glDeleteSync(fences[i]);
+        }
+    }
+
+    // returns only once the frame is done: its per-frame resources (StreamBuffer
+    // regions, FrameArena blocks) are not guarded by anything else
+    void wait() {
+        GLsync &fence = fences[next];
+        if (!fence) return;
+        while (true) {
+            // flush so that the fence is guaranteed to be signaled eventually
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT_NS);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+            if (result == GL_WAIT_FAILED) {
+                // invalid fence or lost context: the GPU can't be tracked any more
+                cout << "FrameThrottle::wait error: glClientWaitSync failed, finishing the GPU work" << endl;
+                glFinish();
+                break;
+            }
+            cout << "FrameThrottle::wait warning: the GPU is still busy after " << TIMEOUT_NS / 1000000 << " ms" << endl;
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    void frameSubmitted() {
+        if (fences[next]) glDeleteSync(fences[next]);
+        fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        next = (next + 1) % fences.size();
+    }
+
+private:
+    static const GLuint64 TIMEOUT_NS = 1000000000;    // 1 s between warnings of a GPU that doesn't finish
+
+    vector<GLsync> fences;       // one per queued frame, ring
+    size_t next;                 // fence of the oldest queued frame, written next
+};
+
+
+#endif
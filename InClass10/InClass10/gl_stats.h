@@ -0,0 +1,547 @@
+#pragma once
+
+// GLStats
+//
+// Opt-in counting layer over the GL entry points the programs use.
+// Include it right after <GL/glew.h>, before any other header that makes GL calls
+// (shader.h, cube.h, the mesh classes, ...): every following call to one of the
+// entry points below goes through a wrapper that counts it and forwards it.
+//
+//   - calls, state sets (program, VAO, buffer bindings indexed ones included,
+//     texture bindings, active texture unit) and the redundant ones (same object
+//     already bound); glDelete* forgets the bindings of the deleted objects
+//   - uniform location lookups, uniform uploads and their bytes
+//   - buffer/texture uploads and their bytes
+//   - draw calls and primitives (instances included)
+//
+// Counters are per frame: frameEnd() after glfwSwapBuffers() closes a frame,
+// lastFrame()/totals() expose them, report() prints averages and maxima.
+// Disabled at run time (the default) the wrappers only forward the call;
+// compiled with GL_STATS_ENABLED 0 nothing is intercepted.
+// Calls made through other paths (e.g. persistently mapped writes) are not seen.
+
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#ifndef GL_STATS_ENABLED
+#define GL_STATS_ENABLED 1
+#endif
+
+#include <GL/glew.h>
+#include <map>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+// GLFrameStats() is all zeros
+struct GLFrameStats {
+    enum Counter {
+        CALLS,                  // intercepted calls
+        STATE_SETS,             // program, VAO, buffer, texture, texture unit
+        REDUNDANT_STATE_SETS,   // the same object was already bound
+        PROGRAM_BINDS,
+        VAO_BINDS,
+        BUFFER_BINDS,           // glBindBuffer/glBindBufferBase/glBindBufferRange
+        TEXTURE_BINDS,
+        UNIFORM_LOOKUPS,        // glGetUniformLocation
+        UNIFORM_UPLOADS,        // glUniform*
+        UNIFORM_BYTES,
+        UPLOADS,                // glBufferData/glBufferSubData/glTexImage2D with data
+        BYTES_UPLOADED,
+        DRAW_CALLS,
+        PRIMITIVES,
+        NUM_COUNTERS
+    };
+
+    unsigned long long counters[NUM_COUNTERS];
+
+    unsigned long long& operator[](Counter c) { return counters[c]; }
+    unsigned long long operator[](Counter c) const { return counters[c]; }
+
+    void add(const GLFrameStats &f) {
+        for (int i = 0; i < NUM_COUNTERS; i++) counters[i] += f.counters[i];
+    }
+
+    void takeMax(const GLFrameStats &f) {
+        for (int i = 0; i < NUM_COUNTERS; i++) if (f.counters[i] > counters[i]) counters[i] = f.counters[i];
+    }
+};
+
+class GLStats {
+
+public:
+    static bool enabled() { return instance().on; }
+    static void setEnabled(bool enabled) { instance().on = enabled; }
+
+    // the frame being recorded
+    static GLFrameStats& current() { return instance().frame; }
+
+    // counters of the last complete frame
+    static const GLFrameStats& lastFrame() { return instance().last; }
+
+    // sums and per-counter maxima over all complete frames
+    static const GLFrameStats& totals() { return instance().sum; }
+    static const GLFrameStats& maxima() { return instance().peak; }
+    static unsigned long long numFrames() { return instance().frames; }
+
+    // after glfwSwapBuffers()
+    static void frameEnd() {
+        GLStats &s = instance();
+        if (!s.on) return;
+        s.last = s.frame;
+        s.sum.add(s.frame);
+        s.peak.takeMax(s.frame);
+        s.frames++;
+        s.frame = GLFrameStats();
+    }
+
+    static void report() {
+        GLStats &s = instance();
+        if (s.frames == 0) {
+            cout << "GL STATS: no frames recorded" << endl;
+            return;
+        }
+        static const char* names[GLFrameStats::NUM_COUNTERS] = {
+            "calls", "state sets", "redundant state sets", "program binds", "VAO binds", "buffer binds",
+            "texture binds", "uniform lookups", "uniform uploads", "uniform bytes", "uploads",
+            "bytes uploaded", "draw calls", "primitives"
+        };
+        cout << "GL STATS: " << s.frames << " frames (per frame: average, max)" << endl;
+        cout << fixed << setprecision(1);
+        for (int i = 0; i < GLFrameStats::NUM_COUNTERS; i++) {
+            cout << "  " << left << setw(22) << names[i] << right << setw(12) << (double)s.sum.counters[i] / s.frames
+                 << setw(12) << s.peak.counters[i] << endl;
+        }
+        if (s.sum[GLFrameStats::STATE_SETS] > 0)
+            cout << "  redundant state sets: "
+                 << 100.0 * s.sum[GLFrameStats::REDUNDANT_STATE_SETS] / s.sum[GLFrameStats::STATE_SETS] << "%" << endl;
+        cout.unsetf(ios::fixed);
+    }
+
+    // state tracking (called by the wrappers)
+    static void stateSet(GLuint &bound, GLuint object, GLFrameStats::Counter counter) {
+        GLFrameStats &f = current();
+        f[GLFrameStats::STATE_SETS]++;
+        f[counter]++;
+        if (bound == object) f[GLFrameStats::REDUNDANT_STATE_SETS]++;
+        bound = object;
+    }
+
+    // glBindBufferBase (size -1) / glBindBufferRange: the indexed binding point and
+    // the generic binding of target
+    static void bufferRangeSet(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+        GLStats &s = instance();
+        GLFrameStats &f = s.frame;
+        f[GLFrameStats::STATE_SETS]++;
+        f[GLFrameStats::BUFFER_BINDS]++;
+        unsigned long long key = ((unsigned long long)target << 32) | index;
+        map<unsigned long long, IndexedBinding>::iterator it = s.indexedBuffers.find(key);
+        if (it != s.indexedBuffers.end() && it->second.buffer == buffer && it->second.offset == offset
+            && it->second.size == size) f[GLFrameStats::REDUNDANT_STATE_SETS]++;
+        IndexedBinding binding = { buffer, offset, size };
+        s.indexedBuffers[key] = binding;
+        boundBuffer(target) = buffer;
+    }
+
+    // the deleted objects are unbound: forget where they were bound
+    static void buffersDeleted(GLsizei n, const GLuint* ids) {
+        GLStats &s = instance();
+        for (GLsizei i = 0; i < n; i++) {
+            if (ids[i] == 0) continue;
+            forget(s.buffers, ids[i]);
+            map<unsigned long long, IndexedBinding>::iterator it = s.indexedBuffers.begin();
+            while (it != s.indexedBuffers.end()) {
+                if (it->second.buffer == ids[i]) s.indexedBuffers.erase(it++);
+                else ++it;
+            }
+        }
+    }
+
+    static void vertexArraysDeleted(GLsizei n, const GLuint* ids) {
+        GLStats &s = instance();
+        for (GLsizei i = 0; i < n; i++) {
+            if (ids[i] != 0 && s.vao == ids[i]) {
+                s.vao = UNKNOWN;
+                vaoChanged();
+            }
+        }
+    }
+
+    static void texturesDeleted(GLsizei n, const GLuint* ids) {
+        GLStats &s = instance();
+        for (GLsizei i = 0; i < n; i++) {
+            if (ids[i] != 0) forget(s.textures, ids[i]);
+        }
+    }
+
+    // the program stays in use until another one is, but its id can be reused after
+    static void programDeleted(GLuint id) {
+        GLStats &s = instance();
+        if (id != 0 && s.program == id) s.program = UNKNOWN;
+    }
+
+    static GLuint& boundProgram() { return instance().program; }
+    static GLuint& boundVAO() { return instance().vao; }
+    static GLuint& activeUnit() { return instance().unit; }
+    static GLuint& boundBuffer(GLenum target) { return tracked(instance().buffers, target); }
+    static GLuint& boundTexture(GLenum target) {
+        GLStats &s = instance();
+        return tracked(s.textures, ((unsigned long long)s.unit << 32) | target);
+    }
+
+    // the VAO owns the element array binding
+    static void vaoChanged() { instance().buffers[GL_ELEMENT_ARRAY_BUFFER] = UNKNOWN; }
+
+    static void draw(GLenum mode, GLsizei count, GLsizei instances) {
+        GLFrameStats &f = current();
+        f[GLFrameStats::DRAW_CALLS]++;
+        unsigned long long n = (unsigned long long)count;
+        switch (mode) {
+        case GL_TRIANGLES: n /= 3; break;
+        case GL_TRIANGLE_STRIP: case GL_TRIANGLE_FAN: n = (n > 2) ? n - 2 : 0; break;
+        case GL_LINES: n /= 2; break;
+        case GL_LINE_STRIP: n = (n > 1) ? n - 1 : 0; break;
+        default: break;
+        }
+        f[GLFrameStats::PRIMITIVES] += n * (unsigned long long)instances;
+    }
+
+    static void upload(unsigned long long bytes) {
+        GLFrameStats &f = current();
+        f[GLFrameStats::UPLOADS]++;
+        f[GLFrameStats::BYTES_UPLOADED] += bytes;
+    }
+
+    static void uniform(unsigned long long bytes) {
+        GLFrameStats &f = current();
+        f[GLFrameStats::UNIFORM_UPLOADS]++;
+        f[GLFrameStats::UNIFORM_BYTES] += bytes;
+    }
+
+    static unsigned int pixelBytes(GLenum format, GLenum type) {
+        unsigned int components = 4;
+        switch (format) {
+        case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+        case GL_RG: components = 2; break;
+        case GL_RGB: case GL_BGR: components = 3; break;
+        default: break;
+        }
+        unsigned int size = 1;
+        switch (type) {
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: size = 2; break;
+        case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: size = 4; break;
+        default: break;
+        }
+        return components * size;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;     // nothing known to be bound: never redundant
+
+    struct IndexedBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;        // -1: whole buffer (glBindBufferBase)
+    };
+
+    bool on;
+    GLFrameStats frame, last, sum, peak;
+    unsigned long long frames;
+    GLuint program, vao, unit;
+    map<GLenum, GLuint> buffers;
+    map<unsigned long long, GLuint> textures;     // (unit << 32) | target
+    map<unsigned long long, IndexedBinding> indexedBuffers;    // (target << 32) | index
+
+    GLStats() : on(false), frame(), last(), sum(), peak(), frames(0) {
+        program = vao = UNKNOWN;
+        unit = GL_TEXTURE0;
+    }
+
+    template <class Key>
+    static GLuint& tracked(map<Key, GLuint> &bindings, Key key) {
+        typename map<Key, GLuint>::iterator it = bindings.find(key);
+        if (it == bindings.end()) it = bindings.insert(make_pair(key, (GLuint)UNKNOWN)).first;
+        return it->second;
+    }
+
+    template <class Key>
+    static void forget(map<Key, GLuint> &bindings, GLuint object) {
+        for (typename map<Key, GLuint>::iterator it = bindings.begin(); it != bindings.end(); ++it) {
+            if (it->second == object) it->second = UNKNOWN;
+        }
+    }
+
+    static GLStats& instance() {
+        static GLStats stats;
+        return stats;
+    }
+};
+
+#if GL_STATS_ENABLED
+
+// wrappers: count, then call the real entry point (still the GLEW one at this point)
+
+#define GL_STATS_CALL() if (GLStats::enabled()) GLStats::current()[GLFrameStats::CALLS]++
+
+inline void glStatsUseProgram(GLuint program) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::stateSet(GLStats::boundProgram(), program, GLFrameStats::PROGRAM_BINDS);
+    glUseProgram(program);
+}
+
+inline void glStatsBindVertexArray(GLuint array) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) {
+        if (GLStats::boundVAO() != array) GLStats::vaoChanged();
+        GLStats::stateSet(GLStats::boundVAO(), array, GLFrameStats::VAO_BINDS);
+    }
+    glBindVertexArray(array);
+}
+
+inline void glStatsBindBuffer(GLenum target, GLuint buffer) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::stateSet(GLStats::boundBuffer(target), buffer, GLFrameStats::BUFFER_BINDS);
+    glBindBuffer(target, buffer);
+}
+
+inline void glStatsBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::bufferRangeSet(target, index, buffer, 0, -1);
+    glBindBufferBase(target, index, buffer);
+}
+
+inline void glStatsBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::bufferRangeSet(target, index, buffer, offset, size);
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+inline void glStatsActiveTexture(GLenum texture) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) {
+        GLFrameStats &f = GLStats::current();
+        f[GLFrameStats::STATE_SETS]++;
+        if (GLStats::activeUnit() == texture) f[GLFrameStats::REDUNDANT_STATE_SETS]++;
+        GLStats::activeUnit() = texture;
+    }
+    glActiveTexture(texture);
+}
+
+inline void glStatsBindTexture(GLenum target, GLuint texture) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) {
+        GLStats::stateSet(GLStats::boundTexture(target), texture, GLFrameStats::TEXTURE_BINDS);
+    }
+    glBindTexture(target, texture);
+}
+
+// deletes: tracked even while disabled, a stale id would make a later bind look redundant
+inline void glStatsDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    GL_STATS_CALL();
+    GLStats::buffersDeleted(n, buffers);
+    glDeleteBuffers(n, buffers);
+}
+
+inline void glStatsDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    GL_STATS_CALL();
+    GLStats::vertexArraysDeleted(n, arrays);
+    glDeleteVertexArrays(n, arrays);
+}
+
+inline void glStatsDeleteTextures(GLsizei n, const GLuint* textures) {
+    GL_STATS_CALL();
+    GLStats::texturesDeleted(n, textures);
+    glDeleteTextures(n, textures);
+}
+
+inline void glStatsDeleteProgram(GLuint program) {
+    GL_STATS_CALL();
+    GLStats::programDeleted(program);
+    glDeleteProgram(program);
+}
+
+inline void glStatsBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    GL_STATS_CALL();
+    if (GLStats::enabled() && data) GLStats::upload(size);
+    glBufferData(target, size, data, usage);
+}
+
+inline void glStatsBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::upload(size);
+    glBufferSubData(target, offset, size, data);
+}
+
+inline void glStatsTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                              GLint border, GLenum format, GLenum type, const void* pixels) {
+    GL_STATS_CALL();
+    if (GLStats::enabled() && pixels)
+        GLStats::upload((unsigned long long)width * height * GLStats::pixelBytes(format, type));
+    glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+inline GLint glStatsGetUniformLocation(GLuint program, const GLchar* name) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::current()[GLFrameStats::UNIFORM_LOOKUPS]++;
+    return glGetUniformLocation(program, name);
+}
+
+inline void glStatsUniform1i(GLint location, GLint v0) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(sizeof(GLint));
+    glUniform1i(location, v0);
+}
+
+inline void glStatsUniform1f(GLint location, GLfloat v0) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(sizeof(GLfloat));
+    glUniform1f(location, v0);
+}
+
+inline void glStatsUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(2 * sizeof(GLfloat));
+    glUniform2f(location, v0, v1);
+}
+
+inline void glStatsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(3 * sizeof(GLfloat));
+    glUniform3f(location, v0, v1, v2);
+}
+
+inline void glStatsUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(4 * sizeof(GLfloat));
+    glUniform4f(location, v0, v1, v2, v3);
+}
+
+inline void glStatsUniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 2 * sizeof(GLfloat));
+    glUniform2fv(location, count, value);
+}
+
+inline void glStatsUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 3 * sizeof(GLfloat));
+    glUniform3fv(location, count, value);
+}
+
+inline void glStatsUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 4 * sizeof(GLfloat));
+    glUniform4fv(location, count, value);
+}
+
+inline void glStatsUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 4 * sizeof(GLfloat));
+    glUniformMatrix2fv(location, count, transpose, value);
+}
+
+inline void glStatsUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 9 * sizeof(GLfloat));
+    glUniformMatrix3fv(location, count, transpose, value);
+}
+
+inline void glStatsUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::uniform(count * 16 * sizeof(GLfloat));
+    glUniformMatrix4fv(location, count, transpose, value);
+}
+
+inline void glStatsDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::draw(mode, count, 1);
+    glDrawArrays(mode, first, count);
+}
+
+inline void glStatsDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::draw(mode, count, 1);
+    glDrawElements(mode, count, type, indices);
+}
+
+inline void glStatsDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::draw(mode, count, instancecount);
+    glDrawArraysInstanced(mode, first, count, instancecount);
+}
+
+inline void glStatsDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+    GL_STATS_CALL();
+    if (GLStats::enabled()) GLStats::draw(mode, count, instancecount);
+    glDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+
+#undef GL_STATS_CALL
+
+// from here on the entry points resolve to the wrappers
+#undef glUseProgram
+#define glUseProgram glStatsUseProgram
+#undef glBindVertexArray
+#define glBindVertexArray glStatsBindVertexArray
+#undef glBindBuffer
+#define glBindBuffer glStatsBindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase glStatsBindBufferBase
+#undef glBindBufferRange
+#define glBindBufferRange glStatsBindBufferRange
+#undef glDeleteBuffers
+#define glDeleteBuffers glStatsDeleteBuffers
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays glStatsDeleteVertexArrays
+#undef glDeleteTextures
+#define glDeleteTextures glStatsDeleteTextures
+#undef glDeleteProgram
+#define glDeleteProgram glStatsDeleteProgram
+#undef glActiveTexture
+#define glActiveTexture glStatsActiveTexture
+#undef glBindTexture
+#define glBindTexture glStatsBindTexture
+#undef glBufferData
+#define glBufferData glStatsBufferData
+#undef glBufferSubData
+#define glBufferSubData glStatsBufferSubData
+#undef glTexImage2D
+#define glTexImage2D glStatsTexImage2D
+#undef glGetUniformLocation
+#define glGetUniformLocation glStatsGetUniformLocation
+#undef glUniform1i
+#define glUniform1i glStatsUniform1i
+#undef glUniform1f
+#define glUniform1f glStatsUniform1f
+#undef glUniform2f
+#define glUniform2f glStatsUniform2f
+#undef glUniform3f
+#define glUniform3f glStatsUniform3f
+#undef glUniform4f
+#define glUniform4f glStatsUniform4f
+#undef glUniform2fv
+#define glUniform2fv glStatsUniform2fv
+#undef glUniform3fv
+#define glUniform3fv glStatsUniform3fv
+#undef glUniform4fv
+#define glUniform4fv glStatsUniform4fv
+#undef glUniformMatrix2fv
+#define glUniformMatrix2fv glStatsUniformMatrix2fv
+#undef glUniformMatrix3fv
+#define glUniformMatrix3fv glStatsUniformMatrix3fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv glStatsUniformMatrix4fv
+#undef glDrawArrays
+#define glDrawArrays glStatsDrawArrays
+#undef glDrawElements
+#define glDrawElements glStatsDrawElements
+#undef glDrawArraysInstanced
+#define glDrawArraysInstanced glStatsDrawArraysInstanced
+#undef glDrawElementsInstanced
+#define glDrawElementsInstanced glStatsDrawElementsInstanced
+
+#endif
+
+
+#endif
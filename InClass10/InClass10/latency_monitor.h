@@ -0,0 +1,312 @@
+#pragma once
+
+// LatencyMonitor
+//
+// Input-to-photon latency and frame pacing measurements for the render loop.
+//
+// Every input event is followed through the pipeline (all times in glfwGetTime() seconds):
+//
+//   input      the GLFW callback ran
+//   published  the input thread published the camera state that contains the event
+//              (after Arcball::cursorCallback/mouseButtonCallback)
+//   render     render() started with that state
+//   swap       glfwSwapBuffers() returned
+//   gpu        the GPU reached the end of the frame (GL_TIMESTAMP query after the
+//              swap, converted to the CPU clock); scan-out adds up to one refresh
+//
+//   - camera events (cursor, button) are consumed by the first frame whose
+//     CameraState::lastEvent includes them, key events by the next frame
+//   - events without a frame within MAX_PENDING (no visible change, e.g. the
+//     cursor moving without a button pressed) are only counted
+//   - frame intervals (swap to swap) shorter than MAX_INTERVAL give the jitter,
+//     longer ones are idle gaps of the render-on-demand loop
+//   - a frame is resolved once its GPU timestamp is read, together with the events
+//     it consumed: both move to fixed rings (RING_SIZE), the oldest samples are
+//     overwritten, so memory and per-frame work stay bounded however long it runs
+//
+// report() prints histograms, writeCSV() dumps one row per event and per frame
+// (the resolved ones still in the rings).
+// All calls from the thread of the GL context (GLFW callbacks run on it too).
+
+#ifndef LATENCY_MONITOR_H
+#define LATENCY_MONITOR_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include "camera_input.h"
+
+using namespace std;
+
+class LatencyMonitor {
+
+public:
+    enum EventType { CURSOR, BUTTON, KEY };
+
+    static constexpr double MAX_PENDING = 0.5;     // seconds
+    static constexpr double MAX_INTERVAL = 0.1;    // seconds
+    static const unsigned int RING_SIZE = 1 << 16;  // resolved events and frames kept
+
+    // the GL context must be current: calibrates the GPU clock against glfwGetTime()
+    LatencyMonitor() {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuOffset = glfwGetTime() - gpuNow * 1e-9;
+        firstPending = 0;
+        firstUnresolvedEvent = 0;
+        firstUnresolved = 0;
+        numEvents = 0;
+        numFrames = 0;
+        numDropped = 0;
+        lastSwap = -1.0;
+        eventRing.resize(RING_SIZE);
+        frameRing.resize(RING_SIZE);
+        numEventSamples = 0;
+        numFrameSamples = 0;
+    }
+
+    ~LatencyMonitor() {
+        for (size_t i = firstUnresolved; i < frames.size(); i++) {
+            if (frames[i].query) glDeleteQueries(1, &frames[i].query);
+        }
+    }
+
+    // in the GLFW callback; cameraEvent: id returned by CameraInput (0 for KEY)
+    void inputEvent(EventType type, unsigned int cameraEvent) {
+        Event e = { type, cameraEvent, numEvents++, glfwGetTime(), -1.0, -1 };
+        events.push_back(e);
+    }
+
+    // at the start of render(), with the state it draws
+    void frameBegin(const CameraState &camera) {
+        long long index = numFrames++;
+        Frame f = { index, glfwGetTime(), -1.0, -1.0, -1.0, 0 };
+        frames.push_back(f);
+
+        size_t i = firstPending;
+        for (; i < events.size(); i++) {
+            Event &e = events[i];
+            if (e.type != KEY && e.cameraEvent > camera.lastEvent) break;    // not applied yet
+            if (f.render - e.input > MAX_PENDING) {
+                numDropped++;
+                continue;
+            }
+            e.frame = index;
+            e.published = (e.type == KEY) ? e.input : camera.publishTime;
+        }
+        firstPending = i;
+    }
+
+    // right after glfwSwapBuffers()
+    void frameEnd() {
+        Frame &f = frames.back();
+        f.swap = glfwGetTime();
+        if (lastSwap >= 0.0) f.interval = f.swap - lastSwap;
+        lastSwap = f.swap;
+        glGenQueries(1, &f.query);
+        glQueryCounter(f.query, GL_TIMESTAMP);
+        resolve(false);
+    }
+
+    // reads the GPU timestamps that are available (all of them with wait) and moves
+    // the frames and the events they consumed to the rings
+    void resolve(bool wait) {
+        for (; firstUnresolved < frames.size(); firstUnresolved++) {
+            Frame &f = frames[firstUnresolved];
+            if (f.swap < 0.0) break;        // between frameBegin() and frameEnd()
+            if (!wait) {
+                // queries complete in order: stop at the first one still in flight
+                GLint available = 0;
+                glGetQueryObjectiv(f.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) break;
+            }
+            GLuint64 gpuTime = 0;
+            glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpuTime);
+            f.gpu = gpuTime * 1e-9 + gpuOffset;
+            glDeleteQueries(1, &f.query);
+            f.query = 0;
+
+            // consumed events are in frame order, dropped ones (frame -1) go with the next frame
+            for (; firstUnresolvedEvent < firstPending; firstUnresolvedEvent++) {
+                const Event &e = events[firstUnresolvedEvent];
+                if (e.frame > f.index) break;
+                EventSample sample = { e.type, e.id, e.frame, e.input, -1.0, -1.0, -1.0, -1.0 };
+                if (e.frame >= 0) {
+                    sample.published = e.published;
+                    sample.render = f.render;
+                    sample.swap = f.swap;
+                    sample.gpu = f.gpu;
+                }
+                eventRing[numEventSamples++ & (RING_SIZE - 1)] = sample;
+            }
+            FrameSample sample = { f.index, f.render, f.swap, f.gpu, f.interval };
+            frameRing[numFrameSamples++ & (RING_SIZE - 1)] = sample;
+        }
+
+        // drop the resolved prefix once it is the larger part: O(1) per entry
+        if (firstUnresolved > COMPACT_MIN && firstUnresolved * 2 > frames.size()) {
+            frames.erase(frames.begin(), frames.begin() + firstUnresolved);
+            firstUnresolved = 0;
+        }
+        if (firstUnresolvedEvent > COMPACT_MIN && firstUnresolvedEvent * 2 > events.size()) {
+            events.erase(events.begin(), events.begin() + firstUnresolvedEvent);
+            firstPending -= firstUnresolvedEvent;
+            firstUnresolvedEvent = 0;
+        }
+    }
+
+    void report() {
+        resolve(true);
+        vector<double> toRender, toSwap, toGpu, intervals;
+        for (unsigned long long i = firstSample(numEventSamples); i < numEventSamples; i++) {
+            const EventSample &e = eventRing[i & (RING_SIZE - 1)];
+            if (e.frame < 0) continue;
+            toRender.push_back((e.render - e.input) * 1000.0);
+            toSwap.push_back((e.swap - e.input) * 1000.0);
+            if (e.gpu >= 0.0) toGpu.push_back((e.gpu - e.input) * 1000.0);
+        }
+        for (unsigned long long i = firstSample(numFrameSamples); i < numFrameSamples; i++) {
+            const FrameSample &f = frameRing[i & (RING_SIZE - 1)];
+            if (f.interval >= 0.0 && f.interval < MAX_INTERVAL) intervals.push_back(f.interval * 1000.0);
+        }
+
+        cout << "LATENCY: " << numEvents << " events, " << numDropped << " without a visible frame, "
+             << numFrames << " frames";
+        if (numEventSamples > RING_SIZE || numFrameSamples > RING_SIZE) cout << " (statistics of the last " << RING_SIZE << ")";
+        cout << endl;
+        histogram("input -> render (ms)", toRender, 2.0);
+        histogram("input -> swap (ms)", toSwap, 2.0);
+        histogram("input -> gpu done (ms)", toGpu, 2.0);
+        histogram("frame interval (ms)", intervals, 1.0);
+    }
+
+    // eventsPath: one row per event, framesPath: one row per frame (times in ms from the first frame)
+    bool writeCSV(const char* eventsPath, const char* framesPath) {
+        resolve(true);
+        unsigned long long firstFrame = firstSample(numFrameSamples);
+        double t0 = (numFrameSamples == 0) ? 0.0 : frameRing[firstFrame & (RING_SIZE - 1)].render;
+        ofstream ev(eventsPath), fr(framesPath);
+        if (!ev || !fr) {
+            cout << "ERROR::LATENCY_MONITOR::FILE_NOT_SUCCESFULLY_WRITTEN: " << eventsPath << ", " << framesPath << endl;
+            return false;
+        }
+        static const char* typeNames[] = { "cursor", "button", "key" };
+        ev << fixed << setprecision(3);
+        ev << "event,type,input_ms,published_ms,render_ms,swap_ms,gpu_ms,frame\n";
+        for (unsigned long long i = firstSample(numEventSamples); i < numEventSamples; i++) {
+            const EventSample &e = eventRing[i & (RING_SIZE - 1)];
+            ev << e.id << "," << typeNames[e.type] << "," << (e.input - t0) * 1000.0 << ",";
+            if (e.frame < 0) {
+                ev << ",,,,\n";
+                continue;
+            }
+            ev << (e.published - t0) * 1000.0 << "," << (e.render - t0) * 1000.0 << ","
+               << (e.swap - t0) * 1000.0 << ",";
+            if (e.gpu >= 0.0) ev << (e.gpu - t0) * 1000.0;
+            ev << "," << e.frame << "\n";
+        }
+        fr << fixed << setprecision(3);
+        fr << "frame,render_ms,swap_ms,gpu_ms,interval_ms\n";
+        for (unsigned long long i = firstFrame; i < numFrameSamples; i++) {
+            const FrameSample &f = frameRing[i & (RING_SIZE - 1)];
+            fr << f.index << "," << (f.render - t0) * 1000.0 << "," << (f.swap - t0) * 1000.0 << ",";
+            if (f.gpu >= 0.0) fr << (f.gpu - t0) * 1000.0;
+            fr << ",";
+            if (f.interval >= 0.0) fr << f.interval * 1000.0;
+            fr << "\n";
+        }
+        cout << "LATENCY: written " << eventsPath << ", " << framesPath << endl;
+        return true;
+    }
+
+private:
+    static const size_t COMPACT_MIN = 256;     // resolved entries before the vectors are compacted
+
+    struct Event {
+        EventType type;
+        unsigned int cameraEvent;    // CameraInput event id
+        unsigned long long id;       // 0, 1, ... in input order
+        double input;
+        double published;            // -1: not consumed by a frame
+        long long frame;             // Frame::index, -1: not consumed by a frame
+    };
+
+    struct Frame {
+        long long index;             // 0, 1, ... in render order
+        double render;
+        double swap;                 // -1: not swapped yet
+        double gpu;                  // -1: timestamp not available yet
+        double interval;             // swap - previous swap, -1 for the first frame
+        unsigned int query;          // GL_TIMESTAMP query, 0 once resolved
+    };
+
+    // resolved, with the times of the frame that consumed the event (-1 if none)
+    struct EventSample {
+        EventType type;
+        unsigned long long id;
+        long long frame;
+        double input, published, render, swap, gpu;
+    };
+
+    struct FrameSample {
+        long long index;
+        double render, swap, gpu, interval;
+    };
+
+    double gpuOffset;                // glfwGetTime() - GPU time
+    vector<Event> events;            // not resolved yet from firstUnresolvedEvent on
+    vector<Frame> frames;            // not resolved yet from firstUnresolved on
+    size_t firstPending;             // events before it are consumed or dropped
+    size_t firstUnresolvedEvent;     // events before it are in eventRing
+    size_t firstUnresolved;          // frames before it are in frameRing
+    unsigned long long numEvents;
+    long long numFrames;
+    int numDropped;
+    double lastSwap;                 // -1: no frame swapped yet
+
+    vector<EventSample> eventRing;   // RING_SIZE, written like Profiler's CPU zones
+    vector<FrameSample> frameRing;
+    unsigned long long numEventSamples, numFrameSamples;    // ever written
+
+    static unsigned long long firstSample(unsigned long long written) {
+        return (written > RING_SIZE) ? written - RING_SIZE : 0;
+    }
+
+    // mean, standard deviation, percentiles and a text histogram of values
+    static void histogram(const char* title, vector<double> values, double bucket) {
+        cout << title << ": ";
+        if (values.empty()) {
+            cout << "no samples" << endl;
+            return;
+        }
+        sort(values.begin(), values.end());
+        double mean = 0.0, var = 0.0;
+        for (size_t i = 0; i < values.size(); i++) mean += values[i];
+        mean /= values.size();
+        for (size_t i = 0; i < values.size(); i++) var += (values[i] - mean) * (values[i] - mean);
+        double stddev = sqrt(var / values.size());
+        cout << fixed << setprecision(2) << "n " << values.size() << ", mean " << mean << ", stddev " << stddev
+             << ", p50 " << values[values.size() / 2] << ", p95 " << values[values.size() * 95 / 100]
+             << ", max " << values.back() << endl;
+
+        const int MAX_BUCKETS = 50;            // the last one collects the rest
+        vector<int> counts(MAX_BUCKETS, 0);
+        for (size_t i = 0; i < values.size(); i++) counts[min((int)(values[i] / bucket), MAX_BUCKETS - 1)]++;
+        int largest = *max_element(counts.begin(), counts.end());
+        for (int b = 0; b < MAX_BUCKETS; b++) {
+            if (counts[b] == 0) continue;
+            cout << setw(7) << b * bucket << (b == MAX_BUCKETS - 1 ? "+ " : "  ") << setw(6) << counts[b] << " "
+                 << string((counts[b] * 40 + largest - 1) / largest, '#') << endl;
+        }
+        cout.unsetf(ios::fixed);
+    }
+};
+
+
+#endif
@@ -0,0 +1,826 @@
+#pragma once
+
+// MeshImporter
+//
+// Loads Wavefront OBJ and glTF 2.0 (.gltf with .bin files or data URIs, .glb)
+// meshes in the vertex layout of the lighting shaders:
+//   location 0: position (vec3), 1: normal (vec3), 2: color (vec3), 3: texcoord (vec2)
+//
+//   - OBJ: the memory-mapped file is split at line boundaries into one chunk per
+//     thread, each chunk is tokenized in place (no string copies, no strtof);
+//     face corners (position, texcoord, normal) are then deduplicated with a hash map
+//   - glTF: every triangle primitive is decoded by its own job, all meshes are
+//     merged into one (node transforms, materials and skins are ignored)
+//   - missing normals are computed from the faces, missing colors are white
+//   - import() prints the parse throughput in MB/s
+//
+// ImportedMesh::upload()/draw() render it like Cylinder, toDesc() feeds MeshFile::save().
+
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include "mapped_file.h"
+#include "mesh_file.h"
+#include "profiler.h"
+#include "gpu_resource.h"
+
+using namespace std;
+
+class ImportedMesh {
+
+public:
+    static const int STRIDE = 11;        // floats per vertex: position, normal, color, texcoord
+
+    vector<float> vertices;
+    vector<unsigned int> indices;        // triangles
+    float boundsMin[3];
+    float boundsMax[3];
+
+    ImportedMesh() {
+        for (int c = 0; c < 3; c++) boundsMin[c] = boundsMax[c] = 0.0f;
+    }
+
+    unsigned int numVertices() { return (unsigned int)(vertices.size() / STRIDE); }
+
+    // interleaved layout of vertices[] (the data is not copied)
+    MeshDesc toDesc() {
+        unsigned int stride = STRIDE * sizeof(float);
+        MeshDesc mesh;
+        mesh.attributes = {
+            { 0, 3, 0,                 stride },     // position
+            { 1, 3, 3 * sizeof(float), stride },     // normal
+            { 2, 3, 6 * sizeof(float), stride },     // color
+            { 3, 2, 9 * sizeof(float), stride }      // texcoord
+        };
+        mesh.vertexData = vertices.data();
+        mesh.vertexBytes = (unsigned int)(vertices.size() * sizeof(float));
+        mesh.numVertices = numVertices();
+        mesh.indices = indices;
+        memcpy(mesh.boundsMin, boundsMin, sizeof(boundsMin));
+        memcpy(mesh.boundsMax, boundsMax, sizeof(boundsMax));
+        mesh.generator = 0;
+        return mesh;
+    }
+
+    void upload() {
+        if (!VAO.id()) {
+            VAO.create("ImportedMesh");
+            VBO.create("ImportedMesh");
+            EBO.create("ImportedMesh");
+        }
+        MeshFile::upload(VAO.id(), VBO.id(), EBO.id(), toDesc());
+        VBO.setSize(vertices.size() * sizeof(float));
+        EBO.setSize(indices.size() * sizeof(unsigned int));
+    }
+
+    // ShaderType: Shader or CachedShader
+    template <class ShaderType>
+    void draw(ShaderType *shader) {
+        PROFILE_GPU_ZONE("ImportedMesh::draw");
+        shader->use();
+        glBindVertexArray(VAO.id());
+        glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+private:
+    GpuVertexArray VAO;
+    GpuBuffer VBO, EBO;
+};
+
+// minimal JSON tree for the glTF header
+struct JsonValue {
+    enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+    Type type = JSON_NULL;
+    double number = 0.0;
+    string str;
+    vector<string> keys;         // JSON_OBJECT: keys[i] names items[i]
+    vector<JsonValue> items;     // JSON_ARRAY and JSON_OBJECT
+
+    const JsonValue* get(const char* key) const {
+        for (size_t i = 0; i < keys.size(); i++)
+            if (keys[i] == key) return &items[i];
+        return NULL;
+    }
+    double num(const char* key, double def) const {
+        const JsonValue* v = get(key);
+        return (v && v->type == JSON_NUMBER) ? v->number : def;
+    }
+    size_t size() const { return items.size(); }
+};
+
+class MeshImporter {
+
+public:
+    static bool import(const char* path, ImportedMesh &mesh) {
+        string ext = extension(path);
+        auto start = chrono::high_resolution_clock::now();
+
+        size_t bytes = 0;
+        bool ok;
+        if (ext == "obj") ok = importObj(path, mesh, bytes);
+        else if (ext == "gltf" || ext == "glb") ok = importGltf(path, ext == "glb", mesh, bytes);
+        else {
+            cout << "ERROR::MESH_IMPORTER::UNSUPPORTED_FORMAT: " << path << endl;
+            return false;
+        }
+        if (!ok || mesh.indices.empty()) {
+            cout << "ERROR::MESH_IMPORTER::NO_TRIANGLES: " << path << endl;
+            return false;
+        }
+        computeBounds(mesh);
+
+        double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+        double mb = bytes / (1024.0 * 1024.0);
+        cout << "imported " << path << ": " << mesh.numVertices() << " vertices, "
+            << mesh.indices.size() / 3 << " triangles, " << mb << " MB in " << seconds * 1000.0 << " ms ("
+            << (seconds > 0.0 ? mb / seconds : 0.0) << " MB/s, " << numThreads() << " threads)" << endl;
+        return true;
+    }
+
+private:
+    // ---- tokenizer (works on [p, end), nothing has to be null-terminated) ----
+
+    static bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+    static void skipBlanks(const char* &p, const char* end) {
+        while (p < end && isBlank(*p)) p++;
+    }
+
+    static void skipLine(const char* &p, const char* end) {
+        while (p < end && *p != '\n') p++;
+        if (p < end) p++;
+    }
+
+    static bool parseInt(const char* &p, const char* end, int &value) {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+        if (p >= end || *p < '0' || *p > '9') return false;
+        int v = 0;
+        while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        value = negative ? -v : v;
+        return true;
+    }
+
+    static bool parseFloat(const char* &p, const char* end, float &value) {
+        double v;
+        if (!parseNumber(p, end, v)) return false;
+        value = (float)v;
+        return true;
+    }
+
+    static bool parseNumber(const char* &p, const char* end, double &value) {
+        skipBlanks(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool digits = false;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10.0 + (*p++ - '0');
+            digits = true;
+        }
+        if (p < end && *p == '.') {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') {
+                mantissa = mantissa * 10.0 + (*p++ - '0');
+                exponent--;
+                digits = true;
+            }
+        }
+        if (!digits) return false;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            int e = 0;
+            if (parseInt(p, end, e)) exponent += e;
+        }
+        double v = (exponent == 0) ? mantissa : mantissa * pow(10.0, exponent);
+        value = negative ? -v : v;
+        return true;
+    }
+
+    static string extension(const char* path) {
+        string s(path);
+        size_t dot = s.rfind('.');
+        if (dot == string::npos) return string();
+        string ext = s.substr(dot + 1);
+        for (size_t i = 0; i < ext.size(); i++) ext[i] = (char)tolower(ext[i]);
+        return ext;
+    }
+
+    static unsigned int numThreads() {
+        unsigned int n = thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+    // runs job(0) ... job(count - 1) on up to numThreads() threads
+    template <class Job>
+    static void parallelFor(unsigned int count, Job job) {
+        unsigned int n = numThreads() < count ? numThreads() : count;
+        if (n <= 1) {
+            for (unsigned int i = 0; i < count; i++) job(i);
+            return;
+        }
+        atomic<unsigned int> next(0);
+        vector<thread> threads;
+        for (unsigned int t = 0; t < n; t++) {
+            threads.push_back(thread([&]() {
+                for (unsigned int i = next++; i < count; i = next++) job(i);
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+    }
+
+    // ---- OBJ ----
+
+    // relative (negative) indices are resolved once the chunk's base is known
+    struct ObjCorner {
+        int v, vt, vn;           // absolute: 1-based, 0: missing; relative: 0-based within the chunk
+        unsigned char relative;  // bit 0: v, bit 1: vt, bit 2: vn
+    };
+
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+        vector<float> positions;     // 3 per "v"
+        vector<float> colors;        // 3 per "v" (white unless "v x y z r g b")
+        vector<float> texcoords;     // 2 per "vt"
+        vector<float> normals;       // 3 per "vn"
+        vector<ObjCorner> corners;
+        vector<int> faceSizes;
+    };
+
+    struct CornerKey {
+        int v, vt, vn;
+        bool operator==(const CornerKey &o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+    };
+
+    struct CornerHash {
+        size_t operator()(const CornerKey &k) const {
+            size_t h = (size_t)k.v * 73856093u;
+            h ^= (size_t)(k.vt + 1) * 19349663u;
+            h ^= (size_t)(k.vn + 1) * 83492791u;
+            return h;
+        }
+    };
+
+    static void parseObjCorner(const char* &p, const char* end, ObjChunk &chunk, ObjCorner &corner) {
+        int counts[3] = { (int)chunk.positions.size() / 3, (int)chunk.texcoords.size() / 2, (int)chunk.normals.size() / 3 };
+        int values[3] = { 0, 0, 0 };
+        corner.relative = 0;
+        for (int k = 0; k < 3; k++) {
+            if (k > 0) {
+                if (p >= end || *p != '/') break;
+                p++;
+            }
+            int idx;
+            if (!parseInt(p, end, idx)) continue;     // "v//vn"
+            if (idx < 0) {
+                values[k] = counts[k] + idx;
+                corner.relative |= (unsigned char)(1 << k);
+            }
+            else values[k] = idx;
+        }
+        corner.v = values[0];
+        corner.vt = values[1];
+        corner.vn = values[2];
+        while (p < end && !isBlank(*p) && *p != '\n' && *p != '\r') p++;
+    }
+
+    static void parseObjChunk(ObjChunk &chunk) {
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+        while (p < end) {
+            skipBlanks(p, end);
+            if (p >= end) break;
+            if (p + 1 < end && p[0] == 'v' && isBlank(p[1])) {
+                p += 2;
+                float v[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+                int n = 0;
+                while (n < 6 && parseFloat(p, end, v[n])) n++;
+                // "v x y z w": the 4th value is the homogeneous weight, a color needs all 6
+                if (n < 6) v[3] = v[4] = v[5] = 1.0f;
+                chunk.positions.insert(chunk.positions.end(), v, v + 3);
+                chunk.colors.insert(chunk.colors.end(), v + 3, v + 6);
+            }
+            else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && isBlank(p[2])) {
+                p += 3;
+                float t[2] = { 0.0f, 0.0f };
+                for (int n = 0; n < 2 && parseFloat(p, end, t[n]); n++) {}
+                chunk.texcoords.insert(chunk.texcoords.end(), t, t + 2);
+            }
+            else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+                p += 3;
+                float n3[3] = { 0.0f, 0.0f, 0.0f };
+                for (int n = 0; n < 3 && parseFloat(p, end, n3[n]); n++) {}
+                chunk.normals.insert(chunk.normals.end(), n3, n3 + 3);
+            }
+            else if (p + 1 < end && p[0] == 'f' && isBlank(p[1])) {
+                p += 2;
+                int size = 0;
+                while (true) {
+                    skipBlanks(p, end);
+                    if (p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+                    ObjCorner corner;
+                    parseObjCorner(p, end, chunk, corner);
+                    chunk.corners.push_back(corner);
+                    size++;
+                }
+                chunk.faceSizes.push_back(size);
+            }
+            skipLine(p, end);   // also skips comments, groups, materials, ...
+        }
+    }
+
+    static bool importObj(const char* path, ImportedMesh &mesh, size_t &bytes) {
+        MappedFile file;
+        if (!file.open(path)) {
+            cout << "ERROR::MESH_IMPORTER::FILE_NOT_SUCCESFULLY_READ: " << path << endl;
+            return false;
+        }
+        bytes = file.size();
+        const char* data = (const char*)file.data();
+        const char* dataEnd = data + file.size();
+
+        // one chunk per thread (at least 64KB each), split after a newline
+        const size_t MIN_CHUNK = 64 * 1024;
+        size_t numChunks = file.size() / MIN_CHUNK + 1;
+        if (numChunks > numThreads()) numChunks = numThreads();
+        vector<ObjChunk> chunks(numChunks);
+        const char* p = data;
+        for (size_t i = 0; i < numChunks; i++) {
+            const char* split = (i + 1 == numChunks) ? dataEnd : data + file.size() * (i + 1) / numChunks;
+            if (split < p) split = p;
+            while (split < dataEnd && split[-1] != '\n') split++;
+            chunks[i].begin = p;
+            chunks[i].end = split;
+            p = split;
+        }
+        parallelFor((unsigned int)numChunks, [&](unsigned int i) { parseObjChunk(chunks[i]); });
+
+        // concatenate the attribute arrays in file order
+        vector<float> positions, colors, texcoords, normals;
+        vector<int> basePos(numChunks), baseTex(numChunks), baseNorm(numChunks);
+        for (size_t i = 0; i < numChunks; i++) {
+            basePos[i] = (int)positions.size() / 3;
+            baseTex[i] = (int)texcoords.size() / 2;
+            baseNorm[i] = (int)normals.size() / 3;
+            positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+            colors.insert(colors.end(), chunks[i].colors.begin(), chunks[i].colors.end());
+            texcoords.insert(texcoords.end(), chunks[i].texcoords.begin(), chunks[i].texcoords.end());
+            normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+        }
+        int numPos = (int)positions.size() / 3, numTex = (int)texcoords.size() / 2, numNorm = (int)normals.size() / 3;
+
+        // resolve, deduplicate and triangulate (fan) the faces
+        unordered_map<CornerKey, unsigned int, CornerHash> unique;
+        unique.reserve(numPos * 2);
+        vector<unsigned char> missingNormal;
+        vector<unsigned int> face;
+        for (size_t i = 0; i < numChunks; i++) {
+            const ObjChunk &chunk = chunks[i];
+            size_t c = 0;
+            for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+                face.clear();
+                for (int k = 0; k < chunk.faceSizes[f]; k++, c++) {
+                    const ObjCorner &corner = chunk.corners[c];
+                    CornerKey key = {
+                        (corner.relative & 1) ? basePos[i] + corner.v : corner.v - 1,
+                        (corner.relative & 2) ? baseTex[i] + corner.vt : corner.vt - 1,
+                        (corner.relative & 4) ? baseNorm[i] + corner.vn : corner.vn - 1
+                    };
+                    if (key.v < 0 || key.v >= numPos) continue;   // broken index: drop the corner
+                    if (key.vt >= numTex) key.vt = -1;
+                    if (key.vn >= numNorm) key.vn = -1;
+
+                    auto found = unique.find(key);
+                    if (found != unique.end()) {
+                        face.push_back(found->second);
+                        continue;
+                    }
+                    unsigned int index = mesh.numVertices();
+                    unique[key] = index;
+                    face.push_back(index);
+
+                    float v[ImportedMesh::STRIDE] = {
+                        positions[key.v * 3], positions[key.v * 3 + 1], positions[key.v * 3 + 2],
+                        0.0f, 0.0f, 0.0f,
+                        colors[key.v * 3], colors[key.v * 3 + 1], colors[key.v * 3 + 2],
+                        0.0f, 0.0f
+                    };
+                    if (key.vn >= 0) memcpy(v + 3, &normals[key.vn * 3], 3 * sizeof(float));
+                    if (key.vt >= 0) memcpy(v + 9, &texcoords[key.vt * 2], 2 * sizeof(float));
+                    mesh.vertices.insert(mesh.vertices.end(), v, v + ImportedMesh::STRIDE);
+                    missingNormal.push_back(key.vn < 0);
+                }
+                for (size_t k = 1; k + 1 < face.size(); k++) {
+                    mesh.indices.push_back(face[0]);
+                    mesh.indices.push_back(face[k]);
+                    mesh.indices.push_back(face[k + 1]);
+                }
+            }
+        }
+        computeNormals(mesh, missingNormal);
+        return true;
+    }
+
+    // area-weighted face normals for the vertices that have none
+    static void computeNormals(ImportedMesh &mesh, const vector<unsigned char> &missing) {
+        bool any = false;
+        for (size_t i = 0; i < missing.size() && !any; i++) any = missing[i] != 0;
+        if (!any) return;
+
+        float* v = mesh.vertices.data();
+        const int S = ImportedMesh::STRIDE;
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+            unsigned int a = mesh.indices[t], b = mesh.indices[t + 1], c = mesh.indices[t + 2];
+            float e1[3], e2[3], n[3];
+            for (int k = 0; k < 3; k++) {
+                e1[k] = v[b * S + k] - v[a * S + k];
+                e2[k] = v[c * S + k] - v[a * S + k];
+            }
+            n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            unsigned int corners[3] = { a, b, c };
+            for (int j = 0; j < 3; j++) {
+                if (!missing[corners[j]]) continue;
+                for (int k = 0; k < 3; k++) v[corners[j] * S + 3 + k] += n[k];
+            }
+        }
+        for (size_t i = 0; i < missing.size(); i++) {
+            if (!missing[i]) continue;
+            float* n = v + i * S + 3;
+            float len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (len > 0.0f) { n[0] /= len; n[1] /= len; n[2] /= len; }
+        }
+    }
+
+    static void computeBounds(ImportedMesh &mesh) {
+        const int S = ImportedMesh::STRIDE;
+        unsigned int n = mesh.numVertices();
+        for (int c = 0; c < 3; c++) mesh.boundsMin[c] = mesh.boundsMax[c] = n > 0 ? mesh.vertices[c] : 0.0f;
+        for (unsigned int i = 1; i < n; i++) {
+            for (int c = 0; c < 3; c++) {
+                float x = mesh.vertices[i * S + c];
+                if (x < mesh.boundsMin[c]) mesh.boundsMin[c] = x;
+                if (x > mesh.boundsMax[c]) mesh.boundsMax[c] = x;
+            }
+        }
+    }
+
+    // ---- JSON ----
+
+    static void skipSpaces(const char* &p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    }
+
+    static bool parseJsonString(const char* &p, const char* end, string &out) {
+        if (p >= end || *p != '"') return false;
+        p++;
+        out.clear();
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end) {
+                p++;
+                switch (*p) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': out += '?'; p += (end - p > 4) ? 4 : 0; break;   // names and URIs only, no unicode needed
+                default: out += *p; break;
+                }
+                p++;
+            }
+            else out += *p++;
+        }
+        if (p >= end) return false;
+        p++;
+        return true;
+    }
+
+    static bool parseJson(const char* &p, const char* end, JsonValue &value, int depth = 0) {
+        if (depth > 64) return false;
+        skipSpaces(p, end);
+        if (p >= end) return false;
+
+        if (*p == '{') {
+            value.type = JsonValue::JSON_OBJECT;
+            p++;
+            skipSpaces(p, end);
+            if (p < end && *p == '}') { p++; return true; }
+            while (true) {
+                skipSpaces(p, end);
+                string key;
+                if (!parseJsonString(p, end, key)) return false;
+                skipSpaces(p, end);
+                if (p >= end || *p != ':') return false;
+                p++;
+                value.keys.push_back(key);
+                value.items.push_back(JsonValue());
+                if (!parseJson(p, end, value.items.back(), depth + 1)) return false;
+                skipSpaces(p, end);
+                if (p < end && *p == ',') { p++; continue; }
+                if (p < end && *p == '}') { p++; return true; }
+                return false;
+            }
+        }
+        if (*p == '[') {
+            value.type = JsonValue::JSON_ARRAY;
+            p++;
+            skipSpaces(p, end);
+            if (p < end && *p == ']') { p++; return true; }
+            while (true) {
+                value.items.push_back(JsonValue());
+                if (!parseJson(p, end, value.items.back(), depth + 1)) return false;
+                skipSpaces(p, end);
+                if (p < end && *p == ',') { p++; continue; }
+                if (p < end && *p == ']') { p++; return true; }
+                return false;
+            }
+        }
+        if (*p == '"') {
+            value.type = JsonValue::JSON_STRING;
+            return parseJsonString(p, end, value.str);
+        }
+        if (end - p >= 4 && strncmp(p, "true", 4) == 0) { value.type = JsonValue::JSON_BOOL; value.number = 1.0; p += 4; return true; }
+        if (end - p >= 5 && strncmp(p, "false", 5) == 0) { value.type = JsonValue::JSON_BOOL; p += 5; return true; }
+        if (end - p >= 4 && strncmp(p, "null", 4) == 0) { value.type = JsonValue::JSON_NULL; p += 4; return true; }
+
+        value.type = JsonValue::JSON_NUMBER;
+        return parseNumber(p, end, value.number);
+    }
+
+    // ---- glTF ----
+
+    struct GltfBuffer {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    struct Accessor {
+        const unsigned char* data;   // first element
+        unsigned int count;
+        unsigned int components;     // 1 (SCALAR) ... 4 (VEC4)
+        unsigned int componentType;  // GL_FLOAT, GL_UNSIGNED_SHORT, ...
+        unsigned int stride;         // in bytes
+        bool normalized;
+    };
+
+    static unsigned int componentSize(unsigned int type) {
+        switch (type) {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+        }
+        return 0;
+    }
+
+    static unsigned int typeComponents(const string &type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    // non-negative integer member (def if absent), false for anything else
+    static bool getUnsigned(const JsonValue &v, const char* key, unsigned int def, unsigned int &value) {
+        double d = v.num(key, def);
+        if (!(d >= 0.0 && d <= 4294967295.0) || d != floor(d)) return false;   // NaN fails too
+        value = (unsigned int)d;
+        return true;
+    }
+
+    // index member into an array of count items, false if absent, not an integer or out of range
+    static bool getIndex(const JsonValue &v, const char* key, size_t count, unsigned int &index) {
+        return v.get(key) && getUnsigned(v, key, 0, index) && index < count;
+    }
+
+    // the accessor that member key of owner refers to (e.g. attributes["POSITION"])
+    static bool getAccessor(const JsonValue &gltf, const vector<GltfBuffer> &buffers, const JsonValue &owner, const char* key, Accessor &acc) {
+        const JsonValue* accessors = gltf.get("accessors");
+        const JsonValue* views = gltf.get("bufferViews");
+        unsigned int index, viewIndex, bufferIndex;
+        if (!accessors || !views || !getIndex(owner, key, accessors->size(), index)) return false;
+        const JsonValue &a = accessors->items[index];
+        const JsonValue* type = a.get("type");
+        if (!type || !getIndex(a, "bufferView", views->size(), viewIndex)) return false;   // sparse/empty: not supported
+        const JsonValue &view = views->items[viewIndex];
+        if (!getIndex(view, "buffer", buffers.size(), bufferIndex) || !buffers[bufferIndex].data) return false;
+
+        unsigned int viewOffset, viewLength, accessorOffset;
+        if (!getUnsigned(a, "count", 0, acc.count) || !getUnsigned(a, "componentType", 0, acc.componentType)
+            || !getUnsigned(view, "byteStride", 0, acc.stride) || !getUnsigned(view, "byteOffset", 0, viewOffset)
+            || !getUnsigned(view, "byteLength", 0, viewLength) || !getUnsigned(a, "byteOffset", 0, accessorOffset))
+            return false;
+        acc.components = typeComponents(type->str);
+        const JsonValue* normalized = a.get("normalized");
+        acc.normalized = normalized && normalized->number != 0.0;
+        unsigned int elementSize = acc.components * componentSize(acc.componentType);
+        if (elementSize == 0) return false;
+        if (acc.stride == 0) acc.stride = elementSize;
+
+        size_t offset = (size_t)viewOffset + accessorOffset;
+        size_t needed = acc.count > 0 ? offset + (size_t)(acc.count - 1) * acc.stride + elementSize : offset;
+        if (needed > buffers[bufferIndex].size || needed > (size_t)viewOffset + viewLength) return false;
+        acc.data = buffers[bufferIndex].data + offset;
+        return true;
+    }
+
+    static float readComponent(const Accessor &acc, unsigned int i, unsigned int c) {
+        const unsigned char* p = acc.data + (size_t)i * acc.stride + c * componentSize(acc.componentType);
+        switch (acc.componentType) {
+        case GL_FLOAT: { float f; memcpy(&f, p, 4); return f; }
+        case GL_UNSIGNED_BYTE: return acc.normalized ? *p / 255.0f : (float)*p;
+        case GL_BYTE: return acc.normalized ? fmax(*(const signed char*)p / 127.0f, -1.0f) : (float)*(const signed char*)p;
+        case GL_UNSIGNED_SHORT: { unsigned short s; memcpy(&s, p, 2); return acc.normalized ? s / 65535.0f : (float)s; }
+        case GL_SHORT: { short s; memcpy(&s, p, 2); return acc.normalized ? fmax(s / 32767.0f, -1.0f) : (float)s; }
+        case GL_UNSIGNED_INT: { unsigned int u; memcpy(&u, p, 4); return (float)u; }
+        }
+        return 0.0f;
+    }
+
+    static unsigned int readIndex(const Accessor &acc, unsigned int i) {
+        const unsigned char* p = acc.data + (size_t)i * acc.stride;
+        switch (acc.componentType) {
+        case GL_UNSIGNED_BYTE: return *p;
+        case GL_UNSIGNED_SHORT: { unsigned short s; memcpy(&s, p, 2); return s; }
+        case GL_UNSIGNED_INT: { unsigned int u; memcpy(&u, p, 4); return u; }
+        }
+        return 0;
+    }
+
+    static bool base64Decode(const string &in, size_t start, vector<unsigned char> &out) {
+        static const string table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        unsigned int bits = 0;
+        int numBits = 0;
+        for (size_t i = start; i < in.size() && in[i] != '='; i++) {
+            size_t v = table.find(in[i]);
+            if (v == string::npos) return false;
+            bits = (bits << 6) | (unsigned int)v;
+            numBits += 6;
+            if (numBits >= 8) {
+                numBits -= 8;
+                out.push_back((unsigned char)((bits >> numBits) & 0xFF));
+            }
+        }
+        return true;
+    }
+
+    struct GltfPrimitive {
+        const JsonValue* primitive;
+        vector<float> vertices;
+        vector<unsigned int> indices;
+        vector<unsigned char> missingNormal;
+    };
+
+    static void decodePrimitive(const JsonValue &gltf, const vector<GltfBuffer> &buffers, GltfPrimitive &prim) {
+        const JsonValue* attributes = prim.primitive->get("attributes");
+        Accessor pos, nrm, col, tex, idx;
+        if (!attributes || !getAccessor(gltf, buffers, *attributes, "POSITION", pos) || pos.components != 3) return;
+        bool hasNormal = getAccessor(gltf, buffers, *attributes, "NORMAL", nrm) && nrm.count == pos.count && nrm.components == 3;
+        bool hasColor = getAccessor(gltf, buffers, *attributes, "COLOR_0", col) && col.count == pos.count && col.components >= 3;
+        bool hasTex = getAccessor(gltf, buffers, *attributes, "TEXCOORD_0", tex) && tex.count == pos.count && tex.components == 2;
+
+        const int S = ImportedMesh::STRIDE;
+        prim.vertices.resize((size_t)pos.count * S);
+        for (unsigned int i = 0; i < pos.count; i++) {
+            float* v = &prim.vertices[(size_t)i * S];
+            for (unsigned int c = 0; c < 3; c++) {
+                v[c] = readComponent(pos, i, c);
+                v[3 + c] = hasNormal ? readComponent(nrm, i, c) : 0.0f;
+                v[6 + c] = hasColor ? readComponent(col, i, c) : 1.0f;
+            }
+            v[9] = hasTex ? readComponent(tex, i, 0) : 0.0f;
+            v[10] = hasTex ? 1.0f - readComponent(tex, i, 1) : 0.0f;   // glTF: origin at the top left
+        }
+        prim.missingNormal.assign(pos.count, hasNormal ? 0 : 1);
+
+        if (getAccessor(gltf, buffers, *prim.primitive, "indices", idx) && idx.components == 1) {
+            prim.indices.resize(idx.count - idx.count % 3);
+            for (unsigned int i = 0; i < prim.indices.size(); i++) {
+                prim.indices[i] = readIndex(idx, i);
+                if (prim.indices[i] >= pos.count) prim.indices[i] = 0;
+            }
+        }
+        else {
+            prim.indices.resize(pos.count - pos.count % 3);
+            for (unsigned int i = 0; i < prim.indices.size(); i++) prim.indices[i] = i;
+        }
+    }
+
+    static bool importGltf(const char* path, bool binary, ImportedMesh &mesh, size_t &bytes) {
+        MappedFile file;
+        if (!file.open(path)) {
+            cout << "ERROR::MESH_IMPORTER::FILE_NOT_SUCCESFULLY_READ: " << path << endl;
+            return false;
+        }
+        bytes = file.size();
+
+        // .glb: 12-byte header, then the JSON chunk and an optional BIN chunk
+        const char* json = (const char*)file.data();
+        const char* jsonEnd = json + file.size();
+        GltfBuffer bin = { NULL, 0 };
+        if (binary) {
+            const unsigned char* d = file.data();
+            unsigned int header[3], chunk[2];
+            if (file.size() < 20) return false;
+            memcpy(header, d, 12);
+            memcpy(chunk, d + 12, 8);
+            if (header[0] != 0x46546C67 || header[1] != 2 || chunk[1] != 0x4E4F534A || 20 + (size_t)chunk[0] > file.size()) {
+                cout << "ERROR::MESH_IMPORTER::INVALID_GLB: " << path << endl;
+                return false;
+            }
+            json = (const char*)d + 20;
+            jsonEnd = json + chunk[0];
+            size_t binStart = 20 + (((size_t)chunk[0] + 3) & ~(size_t)3);
+            if (binStart + 8 <= file.size()) {
+                memcpy(chunk, d + binStart, 8);
+                if (chunk[1] == 0x004E4942 && binStart + 8 + chunk[0] <= file.size()) {
+                    bin.data = d + binStart + 8;
+                    bin.size = chunk[0];
+                }
+            }
+        }
+
+        JsonValue gltf;
+        const char* p = json;
+        if (!parseJson(p, jsonEnd, gltf) || gltf.type != JsonValue::JSON_OBJECT) {
+            cout << "ERROR::MESH_IMPORTER::INVALID_JSON: " << path << endl;
+            return false;
+        }
+
+        // buffers: the GLB chunk, a data URI or a file next to the .gltf
+        string dir(path);
+        size_t slash = dir.find_last_of("/\\");
+        dir = (slash == string::npos) ? string() : dir.substr(0, slash + 1);
+        vector<GltfBuffer> buffers;
+        vector<unique_ptr<MappedFile> > bufferFiles;
+        vector<unique_ptr<vector<unsigned char> > > decoded;
+        const JsonValue* bufferList = gltf.get("buffers");
+        for (size_t i = 0; bufferList && i < bufferList->size(); i++) {
+            const JsonValue* uri = bufferList->items[i].get("uri");
+            GltfBuffer b = { NULL, 0 };
+            if (!uri) b = bin;
+            else if (uri->str.compare(0, 5, "data:") == 0) {
+                size_t comma = uri->str.find(";base64,");
+                decoded.push_back(unique_ptr<vector<unsigned char> >(new vector<unsigned char>()));
+                if (comma != string::npos && base64Decode(uri->str, comma + 8, *decoded.back())) {
+                    b.data = decoded.back()->data();
+                    b.size = decoded.back()->size();
+                }
+            }
+            else {
+                bufferFiles.push_back(unique_ptr<MappedFile>(new MappedFile()));
+                if (bufferFiles.back()->open((dir + uri->str).c_str())) {
+                    b.data = bufferFiles.back()->data();
+                    b.size = bufferFiles.back()->size();
+                    bytes += b.size;
+                }
+            }
+            if (!b.data) cout << "ERROR::MESH_IMPORTER::BUFFER_NOT_LOADED: " << i << endl;
+            buffers.push_back(b);
+        }
+
+        // every triangle primitive of every mesh is decoded by its own job
+        vector<GltfPrimitive> prims;
+        const JsonValue* meshes = gltf.get("meshes");
+        for (size_t m = 0; meshes && m < meshes->size(); m++) {
+            const JsonValue* primitives = meshes->items[m].get("primitives");
+            for (size_t i = 0; primitives && i < primitives->size(); i++) {
+                if (primitives->items[i].num("mode", 4) != 4) continue;   // GL_TRIANGLES only
+                GltfPrimitive prim;
+                prim.primitive = &primitives->items[i];
+                prims.push_back(prim);
+            }
+        }
+        parallelFor((unsigned int)prims.size(), [&](unsigned int i) { decodePrimitive(gltf, buffers, prims[i]); });
+
+        vector<unsigned char> missingNormal;
+        for (size_t i = 0; i < prims.size(); i++) {
+            unsigned int base = mesh.numVertices();
+            mesh.vertices.insert(mesh.vertices.end(), prims[i].vertices.begin(), prims[i].vertices.end());
+            missingNormal.insert(missingNormal.end(), prims[i].missingNormal.begin(), prims[i].missingNormal.end());
+            for (size_t k = 0; k < prims[i].indices.size(); k++) mesh.indices.push_back(base + prims[i].indices[k]);
+        }
+        computeNormals(mesh, missingNormal);
+        return true;
+    }
+};
+
+
+#endif
@@ -0,0 +1,43 @@
+#version 330 core
+// Cylinder generated from gl_VertexID (see Cylinder procedural mode in cylinder.h)
+layout (location = 0) in vec3 aOffset;   // per instance
+layout (location = 1) in vec2 aSize;     // per instance: radius, height
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Object {   // ObjectBlock (InClass10.cpp), one per draw
+    mat4 model;
+    mat3 normalMatrix;   // transpose(inverse(mat3(model))), computed once per object on the CPU
+    vec4 color;          // lamps
+    int numSubdiv;       // procedural cylinder
+};
+layout (std140) uniform Camera {   // CameraUBO
+    mat4 view;
+};
+uniform mat4 projection;
+
+const float PI = 3.141592;
+
+// the 6 vertices of one subdivision: x: 0 = theta, 1 = next angle, y: 1 = top, 0 = bottom
+const vec2 corners[6] = vec2[6](
+    vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0)
+);
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID % 6];
+    int i = gl_VertexID / 6 + int(corner.x);
+    float theta = (PI * 2.0 / float(numSubdiv)) * float(i % numSubdiv);
+
+    float halfHeight = aSize.y / 2.0;
+    vec3 pos = vec3(aSize.x * cos(theta), (corner.y > 0.5) ? halfHeight : -halfHeight, aSize.x * sin(theta));
+
+    FragPos = vec3(model * vec4(pos + aOffset, 1.0));
+    Normal = normalMatrix * pos;   // same normal as the buffer version
+    TexCoords = vec2(float(i) / float(numSubdiv), corner.y);
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+// Profiler
+//
+// Scoped CPU/GPU timing zones exported as a Chrome trace (chrome://tracing, Perfetto):
+//
+//   PROFILE_ZONE("loadTexture");          // CPU time of the enclosing scope
+//   PROFILE_GPU_ZONE("render");           // + GPU time (GL_TIMESTAMP queries), GL thread only
+//   Profiler::setEnabled(true);
+//   ...
+//   Profiler::frameEnd();                 // once per frame, after glfwSwapBuffers()
+//   Profiler::writeTrace("trace.json");
+//
+//   - CPU zones go to a ring buffer of the calling thread (lock-free: only its
+//     thread writes it), the oldest zones are overwritten when it is full
+//   - GPU zones put a timestamp query at both ends; frameEnd() collects the
+//     queries whose results are available (usually a few frames later, never
+//     stalls), converts them to the CPU clock and keeps the last RING_SIZE; a
+//     zone must be closed before the frameEnd() of its frame
+//   - disabled at run time: one relaxed atomic load per zone;
+//     compiled with PROFILER_ENABLED 0: the macros expand to nothing
+//
+// Names must be string literals (only the pointer is stored).
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#include <GL/glew.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+class Profiler {
+
+public:
+    static const unsigned int RING_SIZE = 1 << 16;      // zones per thread, and GPU zones
+
+    static bool enabled() { return instance().on.load(memory_order_relaxed); }
+
+    // GL thread: the first call also calibrates the GPU clock
+    static void setEnabled(bool enabled) {
+        Profiler &p = instance();
+        if (enabled && !p.calibrated) {
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            p.gpuOffset = now() - gpuNow / 1000.0;
+            p.calibrated = true;
+            p.glThread = this_thread::get_id();
+        }
+        p.on.store(enabled, memory_order_relaxed);
+    }
+
+    // microseconds since the profiler was created
+    static double now() {
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - instance().start).count();
+    }
+
+    static void addCpuZone(const char* name, double begin, double end) {
+        ThreadBuffer* t = threadBuffer();
+        unsigned int n = t->written.load(memory_order_relaxed);
+        Zone &z = t->zones[n & (RING_SIZE - 1)];
+        z.name = name;
+        z.begin = begin;
+        z.end = end;
+        t->written.store(n + 1, memory_order_release);
+    }
+
+    // GL thread: query pair of a GPU zone
+    static void beginGpuZone(const char* name, unsigned int queries[2]) {
+        Profiler &p = instance();
+        if (p.freeQueries.size() < 2) {
+            unsigned int q[2];
+            glGenQueries(2, q);
+            p.freeQueries.push_back(q[0]);
+            p.freeQueries.push_back(q[1]);
+        }
+        queries[1] = p.freeQueries.back(); p.freeQueries.pop_back();
+        queries[0] = p.freeQueries.back(); p.freeQueries.pop_back();
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+    }
+
+    static void endGpuZone(const char* name, unsigned int queries[2]) {
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+        PendingGpuZone pending = { name, { queries[0], queries[1] } };
+        instance().pendingGpu.push_back(pending);
+    }
+
+    // GL thread, once per frame: collects the GPU zones that are done
+    static void frameEnd() { instance().resolve(false); }
+
+    // call when no zone is being recorded (e.g. on exit)
+    static bool writeTrace(const char* path) {
+        Profiler &p = instance();
+        p.resolve(true);
+        ofstream out(path);
+        if (!out) {
+            cout << "ERROR::PROFILER::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << endl;
+            return false;
+        }
+        out << "{\"traceEvents\":[\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+        int numZones = 0;
+        unsigned int firstGpu = (p.numGpuZones > RING_SIZE) ? p.numGpuZones - RING_SIZE : 0;
+        for (unsigned int i = firstGpu; i < p.numGpuZones; i++, numZones++) writeZone(out, p.gpuZones[i & (RING_SIZE - 1)], 0);
+
+        lock_guard<mutex> lock(p.threadsMutex);
+        for (size_t t = 0; t < p.threads.size(); t++) {
+            ThreadBuffer* b = p.threads[t].get();
+            int tid = (int)t + 1;
+            string name = b->glThread ? "GL thread" : "thread " + to_string(tid);
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+            unsigned int n = b->written.load(memory_order_acquire);
+            unsigned int first = (n > RING_SIZE) ? n - RING_SIZE : 0;
+            for (unsigned int i = first; i < n; i++, numZones++) writeZone(out, b->zones[i & (RING_SIZE - 1)], tid);
+        }
+        out << "\n]}\n";
+        cout << "PROFILER: " << numZones << " zones written to " << path << endl;
+        return (bool)out;
+    }
+
+private:
+    struct Zone {
+        const char* name;
+        double begin, end;       // microseconds
+    };
+
+    struct ThreadBuffer {
+        Zone zones[RING_SIZE];
+        atomic<unsigned int> written;    // # of zones ever added
+        bool glThread;
+        ThreadBuffer(bool glThread) : written(0) { this->glThread = glThread; }
+    };
+
+    struct PendingGpuZone {
+        const char* name;
+        unsigned int queries[2];
+    };
+
+    atomic<bool> on;
+    chrono::steady_clock::time_point start;
+    mutex threadsMutex;                        // only taken when a thread records its first zone
+    vector<unique_ptr<ThreadBuffer>> threads;  // in order of the first zone
+
+    // GL thread
+    bool calibrated;
+    thread::id glThread;                       // the one that called setEnabled(true)
+    double gpuOffset;                          // now() - GPU time in microseconds
+    vector<unsigned int> freeQueries;
+    vector<PendingGpuZone> pendingGpu;         // in submission order
+    vector<Zone> gpuZones;                     // RING_SIZE, like a ThreadBuffer
+    unsigned int numGpuZones;                  // # of GPU zones ever resolved
+
+    Profiler() : on(false) {
+        start = chrono::steady_clock::now();
+        calibrated = false;
+        gpuOffset = 0.0;
+        gpuZones.resize(RING_SIZE);
+        numGpuZones = 0;
+    }
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    static ThreadBuffer* threadBuffer() {
+        thread_local ThreadBuffer* buffer = NULL;
+        if (!buffer) {
+            Profiler &p = instance();
+            lock_guard<mutex> lock(p.threadsMutex);
+            p.threads.push_back(unique_ptr<ThreadBuffer>(new ThreadBuffer(this_thread::get_id() == p.glThread)));
+            buffer = p.threads.back().get();
+        }
+        return buffer;
+    }
+
+    void resolve(bool wait) {
+        size_t done = 0;
+        for (; done < pendingGpu.size(); done++) {
+            PendingGpuZone &z = pendingGpu[done];
+            if (!wait) {
+                // queries complete in order: stop at the first one still in flight
+                GLint available = 0;
+                glGetQueryObjectiv(z.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) break;
+            }
+            GLuint64 t0 = 0, t1 = 0;
+            glGetQueryObjectui64v(z.queries[0], GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(z.queries[1], GL_QUERY_RESULT, &t1);
+            Zone zone = { z.name, t0 / 1000.0 + gpuOffset, t1 / 1000.0 + gpuOffset };
+            gpuZones[numGpuZones++ & (RING_SIZE - 1)] = zone;
+            freeQueries.push_back(z.queries[0]);
+            freeQueries.push_back(z.queries[1]);
+        }
+        pendingGpu.erase(pendingGpu.begin(), pendingGpu.begin() + done);
+    }
+
+    static void writeZone(ofstream &out, const Zone &z, int tid) {
+        out << ",\n{\"name\":\"" << z.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+            << ",\"ts\":" << z.begin << ",\"dur\":" << (z.end - z.begin) << "}";
+    }
+};
+
+// CPU zone of the enclosing scope
+class ProfileZone {
+
+public:
+    ProfileZone(const char* name) {
+        this->name = Profiler::enabled() ? name : NULL;
+        if (this->name) begin = Profiler::now();
+    }
+
+    ~ProfileZone() {
+        if (name) Profiler::addCpuZone(name, begin, Profiler::now());
+    }
+
+private:
+    const char* name;        // NULL: profiler disabled when the zone started
+    double begin;
+};
+
+// CPU + GPU zone of the enclosing scope (GL thread only)
+class ProfileGpuZone {
+
+public:
+    ProfileGpuZone(const char* name) : cpu(name) {
+        this->name = Profiler::enabled() ? name : NULL;
+        if (this->name) Profiler::beginGpuZone(name, queries);
+    }
+
+    ~ProfileGpuZone() {
+        if (name) Profiler::endGpuZone(name, queries);
+    }
+
+private:
+    ProfileZone cpu;
+    const char* name;
+    unsigned int queries[2];
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) ProfileGpuZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#endif
+
+
+#endif
@@ -0,0 +1,314 @@
+#pragma once
+
+// CachedShader
+//
+// Same interface as Shader (ID, use(), set*()), but the linked program is kept
+// in an on-disk cache (glGetProgramBinary/glProgramBinary):
+//
+//   - cache file: shader_cache_<key>.bin in the working directory
+//   - key: hash of both sources and the GL vendor/renderer/version strings,
+//     so editing a shader or changing the driver never picks up a stale binary
+//   - warm start: the binary is loaded and no shader is compiled at all
+//   - falls back to compiling from source whenever the binary is missing,
+//     rejected by the driver, or program binaries are not supported
+//   - optional defines ("#define NAME value" lines) are inserted right after
+//     the #version line of both stages (see shader_permutation.h)
+//   - deferred: the constructor only submits compile + link; ready() polls
+//     GL_COMPLETION_STATUS_KHR without blocking (see shader_manager.h)
+//   - sources come from the mounted AssetPack when there is one (asset_pack.h)
+//   - the setters take the uniform name as const char*: no string is built per call
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include "asset_pack.h"
+#include "profiler.h"
+#include "gpu_resource.h"
+
+using namespace std;
+
+class CachedShader {
+
+public:
+    unsigned int ID;
+    bool fromCache;      // true when the program was loaded from the binary cache
+
+    CachedShader(const char* vertexPath, const char* fragmentPath, const string &defines = "", bool deferred = false) {
+        PROFILE_ZONE("CachedShader");
+        string vertexCode = injectDefines(readFile(vertexPath), defines);
+        string fragmentCode = injectDefines(readFile(fragmentPath), defines);
+
+        fromCache = false;
+        pending = false;
+        linked = false;
+        name = string(vertexPath) + " + " + fragmentPath;
+        string key = cacheKey(vertexCode, fragmentCode);
+        cachePath = "shader_cache_" + key + ".bin";
+
+        useCache = binarySupported();
+        if (useCache && loadBinary()) {
+            fromCache = true;
+            linked = true;
+            cout << "shader " << name << " loaded from cache" << endl;
+            return;
+        }
+        submit(vertexCode.c_str(), fragmentCode.c_str());
+        if (!deferred) finish();
+    }
+
+    // true once compile + link are done (never blocks when parallel compile is available)
+    bool ready() {
+        if (!pending) return true;
+        if (parallelCompileSupported()) {
+            GLint done = GL_FALSE;
+            glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done) return false;
+        }
+        finish();
+        return true;
+    }
+
+    // blocks until compile + link are done
+    void wait() {
+        if (pending) finish();
+    }
+
+    bool isLinked() { return linked; }
+
+    static bool parallelCompileSupported() {
+        return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    }
+
+    CachedShader(const CachedShader&) = delete;
+    CachedShader& operator=(const CachedShader&) = delete;
+
+    void use() {
+        glUseProgram(ID);
+    }
+    void setBool(const char* name, bool value) const {
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
+    }
+    void setInt(const char* name, int value) const {
+        glUniform1i(glGetUniformLocation(ID, name), value);
+    }
+    void setFloat(const char* name, float value) const {
+        glUniform1f(glGetUniformLocation(ID, name), value);
+    }
+    void setVec2(const char* name, float x, float y) const {
+        glUniform2f(glGetUniformLocation(ID, name), x, y);
+    }
+    void setVec3(const char* name, const glm::vec3 &value) const {
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
+    }
+    void setVec3(const char* name, float x, float y, float z) const {
+        glUniform3f(glGetUniformLocation(ID, name), x, y, z);
+    }
+    void setVec4(const char* name, const glm::vec4 &value) const {
+        glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
+    }
+    void setVec4(const char* name, float x, float y, float z, float w) const {
+        glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
+    }
+    void setMat3(const char* name, const glm::mat3 &mat) const {
+        glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(const char* name, const glm::mat4 &mat) const {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+private:
+    GpuProgram program;  // owns ID (size: the program binary)
+    string name;
+    string cachePath;
+    bool useCache;       // program binaries are supported
+    bool pending;        // compile + link submitted, status not collected yet
+    bool linked;
+    unsigned int vertex, fragment;
+
+    // cache file header
+    struct BinaryHeader {
+        char magic[4];           // "SHBC"
+        unsigned int version;
+        unsigned int format;     // binaryFormat returned by glGetProgramBinary
+        unsigned int length;     // # of bytes following the header
+    };
+    static const unsigned int CACHE_VERSION = 1;
+
+    static bool binarySupported() {
+        if (!GLEW_ARB_get_program_binary) return false;
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }
+
+    static string readFile(const char* path) {
+        const unsigned char* data;
+        size_t size;
+        AssetPack* pack = AssetPack::mounted();
+        if (pack && pack->find(path, data, size)) return string((const char*)data, size);
+
+        ifstream file;
+        file.exceptions(ifstream::failbit | ifstream::badbit);
+        try {
+            file.open(path);
+            stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (ifstream::failure &e) {
+            cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << endl;
+        }
+        return string();
+    }
+
+    static string injectDefines(const string &code, const string &defines) {
+        if (defines.empty()) return code;
+        size_t eol = code.find('\n');
+        if (code.compare(0, 8, "#version") != 0 || eol == string::npos) return defines + code;
+        return code.substr(0, eol + 1) + defines + code.substr(eol + 1);
+    }
+
+    // 64-bit FNV-1a
+    static void hash(unsigned long long &h, const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    static string cacheKey(const string &vertexCode, const string &fragmentCode) {
+        unsigned long long h = 14695981039346656037ULL;
+        hash(h, vertexCode.c_str(), vertexCode.size() + 1);
+        hash(h, fragmentCode.c_str(), fragmentCode.size() + 1);
+        GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; i++) {
+            const char* str = (const char*)glGetString(names[i]);
+            if (str) hash(h, str, string(str).size() + 1);
+        }
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", h);
+        return string(buf);
+    }
+
+    bool loadBinary() {
+        ifstream file(cachePath.c_str(), ios::binary | ios::ate);
+        if (!file) return false;
+        streamoff fileSize = file.tellg();
+        file.seekg(0);
+
+        BinaryHeader header;
+        if (fileSize < (streamoff)sizeof(header)) return false;
+        file.read((char*)&header, sizeof(header));
+        if (!file || string(header.magic, 4) != "SHBC" || header.version != CACHE_VERSION) return false;
+
+        // truncated or corrupt file: never trust the length beyond what is there
+        if (header.length == 0 || (streamoff)header.length > fileSize - (streamoff)sizeof(header)) {
+            cout << "shader cache " << cachePath << " truncated, recompiling" << endl;
+            return false;
+        }
+        vector<char> binary(header.length);
+        if (!file.read(binary.data(), header.length)) {
+            cout << "shader cache " << cachePath << " unreadable, recompiling" << endl;
+            return false;
+        }
+
+        program.create(name);
+        ID = program.id();
+        glProgramBinary(ID, header.format, binary.data(), header.length);
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            // driver update or corrupted file: rebuild from source
+            cout << "shader cache " << cachePath << " rejected, recompiling" << endl;
+            program.reset();
+            ID = 0;
+            return false;
+        }
+        program.setSize(header.length);
+        return true;
+    }
+
+    void saveBinary() {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        program.setSize(length);
+
+        vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(ID, length, NULL, &format, binary.data());
+
+        BinaryHeader header = { { 'S', 'H', 'B', 'C' }, CACHE_VERSION, format, (unsigned int)length };
+        ofstream file(cachePath.c_str(), ios::binary | ios::trunc);
+        if (!file) return;
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+    }
+
+    // starts compile + link of both stages into ID without querying any status,
+    // so a driver with parallel compile can do the work on its own threads
+    void submit(const char* vertexCode, const char* fragmentCode) {
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vertexCode, NULL);
+        glCompileShader(vertex);
+
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fragmentCode, NULL);
+        glCompileShader(fragment);
+
+        program.create(name);
+        ID = program.id();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        // ask the driver to keep the binary retrievable for the cache
+        if (useCache) glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(ID);
+        pending = true;
+    }
+
+    // collects the compile/link status (blocks if the work is not done yet)
+    void finish() {
+        PROFILE_ZONE("CachedShader::finish");
+        checkCompileErrors(vertex, "VERTEX");
+        checkCompileErrors(fragment, "FRAGMENT");
+        linked = checkCompileErrors(ID, "PROGRAM");
+
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        pending = false;
+
+        if (useCache && linked) saveBinary();
+    }
+
+    bool checkCompileErrors(GLuint object, const string &type) {
+        GLint success;
+        GLchar infoLog[1024];
+        if (type != "PROGRAM") {
+            glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(object, 1024, NULL, infoLog);
+                cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << endl;
+            }
+        }
+        else {
+            glGetProgramiv(object, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(object, 1024, NULL, infoLog);
+                cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << endl;
+            }
+        }
+        return success != 0;
+    }
+};
+
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+// Shader interface
+//
+// activeAttributeMask(program): bit i is set when the linked program reads the
+// vertex attribute at location i (glGetActiveAttrib). Inputs that are declared
+// but never used are removed by the linker and don't show up, so a mesh built
+// for this mask skips generating, uploading and fetching those streams.
+//
+// bindUniformBlock(program, name, binding): the program's uniform block reads
+// from whatever buffer range is bound to that binding point.
+
+#ifndef SHADER_INTERFACE_H
+#define SHADER_INTERFACE_H
+
+#include <GL/glew.h>
+
+const unsigned int ALL_ATTRIBUTES = 0xFFFFFFFF;
+
+inline unsigned int activeAttributeMask(unsigned int program) {
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+
+    unsigned int mask = 0;
+    char name[256];
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(program, i, sizeof(name), NULL, &size, &type, name);
+        GLint location = glGetAttribLocation(program, name);
+        if (location >= 0 && location < 32) mask |= 1u << location;   // built-ins (gl_VertexID) have none
+    }
+    return mask;
+}
+
+// false if the program has no (active) block of that name
+inline bool bindUniformBlock(unsigned int program, const char* name, unsigned int binding) {
+    unsigned int index = glGetUniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(program, index, binding);
+    return true;
+}
+
+
+#endif
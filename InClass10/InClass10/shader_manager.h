@@ -0,0 +1,71 @@
+#pragma once
+
+// ShaderManager
+//
+// Submits every shader up front and lets the driver compile them in parallel.
+//
+//   - uses GL_KHR_parallel_shader_compile (or the ARB version) when available:
+//     all driver compiler threads are enabled and completion is polled with
+//     GL_COMPLETION_STATUS_KHR, so update() never blocks
+//   - a program can be used as soon as its own ready() returns true, startup
+//     waits for the slowest shader instead of the sum of all of them
+//   - without the extension ready() simply finishes the compile (blocking),
+//     which is the old synchronous behavior
+//
+// The manager only tracks pending shaders, the caller owns them.
+
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <vector>
+#include "shader_cache.h"
+
+using namespace std;
+
+class ShaderManager {
+
+public:
+    ShaderManager() {
+        if (GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);   // as many threads as the driver wants
+        else if (GLEW_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        cout << "parallel shader compile: " << (CachedShader::parallelCompileSupported() ? "on" : "off") << endl;
+    }
+
+    // starts compiling (or loads from the binary cache) and returns immediately
+    CachedShader* submit(const char* vertexPath, const char* fragmentPath, const string &defines = "") {
+        CachedShader* shader = new CachedShader(vertexPath, fragmentPath, defines, true);
+        track(shader);
+        return shader;
+    }
+
+    void track(CachedShader* shader) {
+        if (!shader->ready()) pending.push_back(shader);
+    }
+
+    // polls all pending shaders once, returns the number still compiling
+    int update() {
+        for (size_t i = 0; i < pending.size(); ) {
+            if (pending[i]->ready()) {
+                pending[i] = pending.back();
+                pending.pop_back();
+            }
+            else i++;
+        }
+        return (int)pending.size();
+    }
+
+    void waitAll() {
+        for (size_t i = 0; i < pending.size(); i++) pending[i]->wait();
+        pending.clear();
+    }
+
+    int numPending() { return (int)pending.size(); }
+
+private:
+    vector<CachedShader*> pending;
+};
+
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+// ShaderPermutations
+//
+// #define-specialized variants of one shader pair, built from the active light set.
+//
+//   - a variant is compiled the first time its configuration is requested
+//     and kept (by key) for later requests
+//   - every variant goes through CachedShader, so it is also cached on disk
+//   - with a ShaderManager, variants are only submitted by get(): check
+//     ready() before using them
+//   - the shader sources must provide defaults with #ifndef, e.g.
+//       #ifndef NR_POINT_LIGHTS
+//       #define NR_POINT_LIGHTS 2
+//       #endif
+
+#ifndef SHADER_PERMUTATION_H
+#define SHADER_PERMUTATION_H
+
+#include <map>
+#include <string>
+#include <sstream>
+#include "shader_cache.h"
+#include "shader_manager.h"
+
+using namespace std;
+
+struct LightConfig {
+    int numDirLights;      // 0 or 1
+    int numPointLights;
+    int numSpotLights;     // 0 or 1
+    bool specularMap;      // a specular map is bound to material.specular
+
+    string defines() const {
+        stringstream ss;
+        ss << "#define NR_DIR_LIGHTS " << numDirLights << "\n"
+           << "#define NR_POINT_LIGHTS " << numPointLights << "\n"
+           << "#define NR_SPOT_LIGHTS " << numSpotLights << "\n"
+           << "#define HAS_SPECULAR_MAP " << (specularMap ? 1 : 0) << "\n";
+        return ss.str();
+    }
+};
+
+class ShaderPermutations {
+
+public:
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath, ShaderManager* manager = NULL) {
+        this->vertexPath = vertexPath;
+        this->fragmentPath = fragmentPath;
+        this->manager = manager;
+    }
+
+    ~ShaderPermutations() {
+        for (map<string, CachedShader*>::iterator it = variants.begin(); it != variants.end(); ++it)
+            delete it->second;
+    }
+
+    // the variant for config, compiled on first use
+    CachedShader* get(const LightConfig &config) {
+        string key = config.defines();
+        map<string, CachedShader*>::iterator it = variants.find(key);
+        if (it != variants.end()) return it->second;
+
+        cout << "shader variant: dir " << config.numDirLights << ", point " << config.numPointLights
+             << ", spot " << config.numSpotLights << ", specular map " << config.specularMap << endl;
+        CachedShader* shader = new CachedShader(vertexPath.c_str(), fragmentPath.c_str(), key, manager != NULL);
+        if (manager) manager->track(shader);
+        variants[key] = shader;
+        return shader;
+    }
+
+    int size() { return (int)variants.size(); }
+
+private:
+    string vertexPath;
+    string fragmentPath;
+    ShaderManager* manager;
+    map<string, CachedShader*> variants;
+};
+
+
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+
+// StreamBuffer
+//
+// One buffer for all data that changes every frame (uniform blocks, instance
+// data, dynamic vertices), written by the CPU ahead of the GPU:
+//
+//   StreamBuffer stream("frame", 64 << 10, pipeline.framesInFlight());
+//   pipeline.beginFrame();                         // FramePipeline: the GPU is done with frame N - numFrames
+//   stream.beginFrame();                           // next region
+//   StreamRange range;
+//   stream.allocateUniform(sizeof(block), range);  // bump allocation, no GL call
+//   memcpy(range.data, &block, sizeof(block));
+//   ...                                            // all writes of the frame
+//   stream.flush();                                // before the draws that read them
+//   glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset, range.size);
+//   ...
+//   stream.endFrame();                             // after the last draw (glfwSwapBuffers())
+//
+//   - the buffer is split into numFrames regions used in turn; it has no fences of
+//     its own: the caller keeps at most numFrames frames in flight (FramePipeline)
+//     and calls beginFrame() after waiting for the oldest one
+//   - persistent mode (ARB_buffer_storage): the buffer stays mapped
+//     (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT), range.data points into it and
+//     flush() does nothing
+//   - otherwise: range.data points into a copy in client memory, flush() uploads
+//     what was written since the last flush with one glBufferSubData()
+//   - a frame that needs more than bytesPerFrame gets no range (allocate()
+//     returns false): raise the size
+//
+// Ranges are only valid for the frame they were allocated in. GL thread only.
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include "gpu_resource.h"
+
+using namespace std;
+
+// bytes of the current frame in a StreamBuffer
+struct StreamRange {
+    void* data;              // where the CPU writes them
+    unsigned int buffer;     // GL buffer
+    unsigned int offset;     // bytes from the start of the buffer
+    unsigned int size;
+};
+
+class StreamBuffer {
+
+public:
+    static const int NUM_FRAMES = 3;       // regions: >= frames in flight (FramePipeline)
+    static const unsigned int ALIGNMENT = 16;
+
+    StreamBuffer(const string &name, unsigned int bytesPerFrame, int numFrames = NUM_FRAMES) {
+        this->name = name;
+        this->numFrames = (numFrames < 1) ? 1 : numFrames;
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        uniformAlignment = (alignment > (GLint)ALIGNMENT) ? (unsigned int)alignment : (unsigned int)ALIGNMENT;
+        // every region starts at a valid glBindBufferRange() offset
+        regionSize = (bytesPerFrame + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+        region = 0;
+        offset = 0;
+        flushed = 0;
+        mapped = NULL;
+        frame = 0;
+        peakBytes = 0;
+        numOverflows = 0;
+
+        unsigned int total = regionSize * this->numFrames;
+        buffer.create("StreamBuffer " + name);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+        persistent = GLEW_ARB_buffer_storage;
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+            mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+        }
+        else {
+            cout << "StreamBuffer: ARB_buffer_storage not supported, " << name << " uploaded with glBufferSubData" << endl;
+            glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+            shadow.resize(total);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer.setSize(total);
+    }
+
+    ~StreamBuffer() {
+        if (mapped) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // after the GPU finished the frame that last used the next region
+    void beginFrame() {
+        frame++;
+        region = (int)(frame % numFrames);
+        offset = 0;
+        flushed = 0;
+    }
+
+    void endFrame() {
+        flush();
+        if (offset > peakBytes) peakBytes = offset;
+    }
+
+    // false when the region of this frame is full
+    bool allocate(unsigned int size, StreamRange &range, unsigned int alignment = ALIGNMENT) {
+        unsigned int start = (offset + alignment - 1) / alignment * alignment;
+        if (start + size > regionSize) {
+            numOverflows++;
+            if (numOverflows <= MAX_MESSAGES)
+                cout << "StreamBuffer::allocate error: " << size << " bytes don't fit the " << regionSize
+                     << " bytes per frame of " << name << endl;
+            return false;
+        }
+        offset = start + size;
+        unsigned int at = region * regionSize + start;
+        range.data = persistent ? mapped + at : &shadow[at];
+        range.buffer = buffer.id();
+        range.offset = at;
+        range.size = size;
+        return true;
+    }
+
+    // aligned for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+    bool allocateUniform(unsigned int size, StreamRange &range) {
+        return allocate(size, range, uniformAlignment);
+    }
+
+    // allocate() + copy
+    bool write(const void* data, unsigned int size, StreamRange &range, unsigned int alignment = ALIGNMENT) {
+        if (!allocate(size, range, alignment)) return false;
+        memcpy(range.data, data, size);
+        return true;
+    }
+
+    bool writeUniform(const void* data, unsigned int size, StreamRange &range) {
+        if (!allocateUniform(size, range)) return false;
+        memcpy(range.data, data, size);
+        return true;
+    }
+
+    // makes the writes so far visible to the following draws
+    void flush() {
+        if (persistent || offset == flushed) return;
+        unsigned int at = region * regionSize + flushed;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, at, offset - flushed, &shadow[at]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        flushed = offset;
+    }
+
+    bool isPersistent() { return persistent; }
+    unsigned int used() { return offset; }
+    unsigned int capacity() { return regionSize; }
+
+    void report() {
+        cout << "STREAM BUFFER " << name << ": " << (persistent ? "persistent" : "glBufferSubData") << ", "
+             << numFrames << " x " << regionSize << " bytes, peak " << peakBytes << " per frame in "
+             << frame << " frames, " << numOverflows << " overflows" << endl;
+    }
+
+private:
+    static const int MAX_MESSAGES = 10;
+
+    string name;
+    GpuBuffer buffer;
+    bool persistent;
+    char* mapped;                // persistent mode: all regions
+    vector<char> shadow;         // otherwise: the client copy of all regions
+    int numFrames;
+    unsigned int regionSize;
+    unsigned int uniformAlignment;   // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, at least ALIGNMENT
+    int region;                  // region of the current frame
+    unsigned int offset;         // bytes allocated in it
+    unsigned int flushed;        // bytes of it already uploaded (glBufferSubData mode)
+    unsigned long long frame;
+    unsigned int peakBytes;
+    int numOverflows;
+};
+
+
+#endif